@@ -0,0 +1,281 @@
+/*
+ * Times the interpreter's hot primitives on their own, without lexing, compiling or (where it
+ * can be helped) collecting getting in the way.
+ *
+ * usage: micro [FILTER]
+ *
+ * Only benchmarks whose names contain FILTER are run. Each one is first run with twice as many
+ * iterations until a batch takes at least `MIN_BATCH_NS`, then one batch is run to warm up,
+ * and then `SAMPLES` batches are timed. A tab separated line is written for each benchmark,
+ * with the median, fastest and slowest batch's nanoseconds per iteration; the median is the
+ * one to compare, and a wide spread means the machine was too noisy to trust it.
+ *
+ * Values that benchmarks use are kept in locals of `run_benchmarks` or in books they reference,
+ * as the only roots the gc has besides the program are on the C stack.
+ */
+#include <squire/value.h>
+#include <squire/text.h>
+#include <squire/book.h>
+#include <squire/codex.h>
+#include <squire/journey.h>
+#include <squire/numeral.h>
+#include <squire/program.h>
+#include <squire/gc.h>
+#include <squire/shared.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_BATCH_NS 10000000 // 10ms
+#define SAMPLES 11
+
+// Results are written here so the compiler can't optimize benchmarks away.
+static volatile sq_value sink;
+
+struct fixture {
+	sq_value lhs, rhs;
+	struct sq_book *book;
+	struct sq_codex *codex;
+	const struct sq_journey *journey;
+	size_t size, index;
+};
+
+struct benchmark {
+	char name[64];
+	void (*run)(struct fixture *fixture, size_t iterations);
+	struct fixture *fixture;
+};
+
+static unsigned long long now_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static double time_batch(const struct benchmark *benchmark, size_t iterations) {
+	unsigned long long start = now_ns();
+	benchmark->run(benchmark->fixture, iterations);
+	return (double) (now_ns() - start);
+}
+
+static int compare_doubles(const void *l, const void *r) {
+	double lhs = *(const double *) l, rhs = *(const double *) r;
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static void measure(const struct benchmark *benchmark, const char *filter) {
+	if (filter != NULL && strstr(benchmark->name, filter) == NULL)
+		return;
+
+	size_t iterations = 1;
+	while (time_batch(benchmark, iterations) < MIN_BATCH_NS)
+		iterations *= 2;
+
+	time_batch(benchmark, iterations);
+
+	double samples[SAMPLES];
+	for (unsigned i = 0; i < SAMPLES; ++i)
+		samples[i] = time_batch(benchmark, iterations) / iterations;
+
+	qsort(samples, SAMPLES, sizeof *samples, compare_doubles);
+	printf("%s\t%zu\t%.2f\t%.2f\t%.2f\n", benchmark->name, iterations,
+		samples[SAMPLES / 2], samples[0], samples[SAMPLES - 1]);
+	fflush(stdout);
+}
+
+static sq_value new_text(const char *format, size_t argument) {
+	char buf[64];
+	snprintf(buf, sizeof buf, format, argument);
+
+	return sq_value_new_text(sq_text_new(strdup(buf)));
+}
+
+// A text of `length` `a`s, allocated separately each time so comparisons can't short circuit.
+static sq_value repeated_text(size_t length) {
+	char *ptr = sq_malloc_vec(char, length + 1);
+	memset(ptr, 'a', length);
+	ptr[length] = '\0';
+
+	return sq_value_new_text(sq_text_new2(ptr, length));
+}
+
+static void run_add(struct fixture *fixture, size_t iterations) {
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sq_value_add(fixture->lhs, fixture->rhs);
+}
+
+static void run_eql(struct fixture *fixture, size_t iterations) {
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sq_value_eql(fixture->lhs, fixture->rhs);
+}
+
+static void run_codex_index(struct fixture *fixture, size_t iterations) {
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sq_codex_index(fixture->codex, sq_book_index(fixture->book, i % fixture->size));
+}
+
+static void run_codex_index_assign(struct fixture *fixture, size_t iterations) {
+	for (size_t i = 0; i < iterations; ++i)
+		sq_codex_index_assign(fixture->codex, sq_book_index(fixture->book, i % fixture->size),
+			sq_value_new_numeral(i));
+}
+
+static void run_book_insert_delete(struct fixture *fixture, size_t iterations) {
+	for (size_t i = 0; i < iterations; ++i) {
+		sq_book_insert(fixture->book, fixture->index, SQ_NI);
+		sink = sq_book_delete(fixture->book, fixture->index);
+	}
+}
+
+static void run_gc_malloc(struct fixture *fixture, size_t iterations) {
+	(void) fixture;
+
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sq_value_new_text(sq_gc_malloc(SQ_G_TEXT));
+}
+
+static void run_numeral_to_roman(struct fixture *fixture, size_t iterations) {
+	sq_numeral numeral = sq_value_as_numeral(fixture->lhs);
+
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sq_value_new_text(sq_numeral_to_roman(numeral));
+}
+
+static void run_journey(struct fixture *fixture, size_t iterations) {
+	sq_value argument = fixture->lhs;
+	struct sq_args args = { .pargc = 1, .pargv = &argument };
+
+	for (size_t i = 0; i < iterations; ++i)
+		sink = sq_journey_run(fixture->journey, args);
+}
+
+static const struct sq_journey *find_journey(const struct sq_program *program, const char *name) {
+	for (unsigned i = 0; i < program->nglobals; ++i)
+		if (sq_value_is_journey(program->globals[i])
+			&& !strcmp(sq_value_as_journey(program->globals[i])->name, name))
+			return sq_value_as_journey(program->globals[i]);
+
+	sq_bug("journey '%s' wasn't compiled", name);
+}
+
+#define CODEX_SIZES 3
+#define BOOK_SIZES 3
+#define TEXT_LENGTHS 3
+#define ROMAN_NUMERALS 3
+
+// The gc only scans the frames below `sq_gc_init`'s, so values can't be kept in `main` itself.
+static SQ_ATTR(noinline) void run_benchmarks(const struct sq_program *program, const char *filter) {
+	struct benchmark benchmark;
+
+	printf("# name\titerations\tmedian_ns\tmin_ns\tmax_ns\n");
+
+	struct fixture numerals = { .lhs = sq_value_new_numeral(12), .rhs = sq_value_new_numeral(30) };
+	benchmark = (struct benchmark) { "value-add/numeral", run_add, &numerals };
+	measure(&benchmark, filter);
+
+	struct fixture texts = { .lhs = repeated_text(16), .rhs = repeated_text(16) };
+	benchmark = (struct benchmark) { "value-add/text-16", run_add, &texts };
+	measure(&benchmark, filter);
+
+	static const size_t text_lengths[TEXT_LENGTHS] = { 8, 64, 1024 };
+	struct fixture equal_texts[TEXT_LENGTHS];
+
+	for (unsigned i = 0; i < TEXT_LENGTHS; ++i) {
+		equal_texts[i] = (struct fixture) {
+			.lhs = repeated_text(text_lengths[i]), .rhs = repeated_text(text_lengths[i])
+		};
+		benchmark = (struct benchmark) { .run = run_eql, .fixture = &equal_texts[i] };
+		snprintf(benchmark.name, sizeof benchmark.name, "value-eql/text-%zu", text_lengths[i]);
+		measure(&benchmark, filter);
+	}
+
+	static const size_t codex_sizes[CODEX_SIZES] = { 8, 256, 16384 };
+	struct fixture codices[CODEX_SIZES];
+
+	for (unsigned i = 0; i < CODEX_SIZES; ++i) {
+		codices[i] = (struct fixture) {
+			.book = sq_book_allocate(codex_sizes[i]),
+			.codex = sq_codex_allocate(codex_sizes[i]),
+			.size = codex_sizes[i]
+		};
+
+		for (size_t j = 0; j < codex_sizes[i]; ++j) {
+			sq_value key = new_text("key-%zu", j);
+			sq_book_push(codices[i].book, key);
+			sq_codex_index_assign(codices[i].codex, key, sq_value_new_numeral(j));
+		}
+
+		benchmark = (struct benchmark) { .run = run_codex_index, .fixture = &codices[i] };
+		snprintf(benchmark.name, sizeof benchmark.name, "codex-index/%zu", codex_sizes[i]);
+		measure(&benchmark, filter);
+
+		benchmark = (struct benchmark) { .run = run_codex_index_assign, .fixture = &codices[i] };
+		snprintf(benchmark.name, sizeof benchmark.name, "codex-index-assign/%zu", codex_sizes[i]);
+		measure(&benchmark, filter);
+	}
+
+	static const size_t book_sizes[BOOK_SIZES] = { 16, 1024, 65536 };
+	struct fixture books[BOOK_SIZES], front_books[BOOK_SIZES];
+
+	for (unsigned i = 0; i < BOOK_SIZES; ++i) {
+		books[i] = (struct fixture) { .book = sq_book_allocate(book_sizes[i]), .index = book_sizes[i] / 2 };
+		front_books[i] = (struct fixture) { .book = sq_book_allocate(book_sizes[i]), .index = 0 };
+
+		for (size_t j = 0; j < book_sizes[i]; ++j) {
+			sq_book_push(books[i].book, sq_value_new_numeral(j));
+			sq_book_push(front_books[i].book, sq_value_new_numeral(j));
+		}
+
+		benchmark = (struct benchmark) { .run = run_book_insert_delete, .fixture = &books[i] };
+		snprintf(benchmark.name, sizeof benchmark.name, "book-insert-delete/middle-%zu", book_sizes[i]);
+		measure(&benchmark, filter);
+
+		benchmark = (struct benchmark) { .run = run_book_insert_delete, .fixture = &front_books[i] };
+		snprintf(benchmark.name, sizeof benchmark.name, "book-insert-delete/front-%zu", book_sizes[i]);
+		measure(&benchmark, filter);
+	}
+
+	benchmark = (struct benchmark) { "gc-malloc/unfragmented", run_gc_malloc, NULL };
+	measure(&benchmark, filter);
+
+	// Keeps every other value of a large heap alive, so allocating has to search for holes.
+	struct fixture fragmented = { .book = sq_book_allocate(1 << 19) };
+
+	for (size_t i = 0; i < (1 << 20); ++i) {
+		sq_value value = sq_value_new_text(sq_gc_malloc(SQ_G_TEXT));
+
+		if (i % 2)
+			sq_book_push(fragmented.book, value);
+	}
+
+	sq_gc_start();
+	benchmark = (struct benchmark) { "gc-malloc/fragmented", run_gc_malloc, &fragmented };
+	measure(&benchmark, filter);
+
+	static const sq_numeral roman_numerals[ROMAN_NUMERALS] = { 7, 1994, 29999 };
+	struct fixture romans[ROMAN_NUMERALS];
+
+	for (unsigned i = 0; i < ROMAN_NUMERALS; ++i) {
+		romans[i] = (struct fixture) { .lhs = sq_value_new_numeral(roman_numerals[i]) };
+		benchmark = (struct benchmark) { .run = run_numeral_to_roman, .fixture = &romans[i] };
+		snprintf(benchmark.name, sizeof benchmark.name, "numeral-to-roman/%lld",
+			(long long) roman_numerals[i]);
+		measure(&benchmark, filter);
+	}
+
+	struct fixture call = { .lhs = sq_value_new_numeral(1), .journey = find_journey(program, "identity") };
+	benchmark = (struct benchmark) { "journey-run/identity", run_journey, &call };
+	measure(&benchmark, filter);
+}
+
+int main(int argc, const char **argv) {
+	struct sq_program program;
+
+	sq_gc_init(&program);
+	sq_program_compile(&program, "journey identity(x) { reward x }");
+	run_benchmarks(&program, argc > 1 ? argv[1] : NULL);
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Runs each workload in a workloads file a number of times, and writes a tab separated line
+ * for each: its median, fastest and slowest wall time, its peak rss, and how many collections
+ * the gc did (which is the same every run).
+ *
+ * usage: run SQUIRE RUNS WORKLOADS
+ *
+ * Each line of WORKLOADS is a name, the directory to run in, and the arguments to give
+ * SQUIRE, separated by tabs (the arguments themselves are separated by spaces). Blank lines
+ * and ones starting with `#` are ignored.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define MAX_ARGS 32
+#define MAX_RUNS 101
+
+struct workload {
+	char *name, *directory;
+	char *argv[MAX_ARGS + 3]; // with room for the executable, `--gc-stats` and `NULL`.
+};
+
+struct result {
+	double seconds;
+	long peak_rss; // in kilobytes
+	unsigned long nursery_collections, full_collections;
+};
+
+static unsigned long read_count(const char *stats, const char *key) {
+	const char *found = strstr(stats, key);
+	return found == NULL ? 0 : strtoul(found + strlen(key), NULL, 10);
+}
+
+static void read_gc_stats(const char *path, struct result *result) {
+	char stats[4096];
+	FILE *file = fopen(path, "r");
+
+	if (file == NULL) {
+		perror(path);
+		exit(1);
+	}
+
+	stats[fread(stats, 1, sizeof stats - 1, file)] = '\0';
+	fclose(file);
+
+	result->nursery_collections = read_count(stats, "\"nursery\": ");
+	result->full_collections = read_count(stats, "\"full\": ");
+}
+
+static struct result run(const struct workload *workload) {
+	struct result result;
+	struct timespec start, stop;
+	struct rusage usage;
+	int status;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pid_t child = fork();
+
+	if (child < 0) {
+		perror("fork");
+		exit(1);
+	}
+
+	if (!child) {
+		int null = open("/dev/null", O_WRONLY);
+
+		if (chdir(workload->directory) || null < 0 || dup2(null, STDOUT_FILENO) < 0) {
+			perror(workload->directory);
+			_exit(127);
+		}
+
+		execv(workload->argv[0], workload->argv);
+		perror(workload->argv[0]);
+		_exit(127);
+	}
+
+	if (wait4(child, &status, 0, &usage) < 0) {
+		perror("wait4");
+		exit(1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "%s: failed with status %d\n", workload->name, status);
+		exit(1);
+	}
+
+	result.seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+#ifdef __APPLE__
+	result.peak_rss = usage.ru_maxrss / 1024; // macOS reports it in bytes
+#else
+	result.peak_rss = usage.ru_maxrss;
+#endif
+
+	return result;
+}
+
+static int compare_seconds(const void *l, const void *r) {
+	double lhs = ((const struct result *) l)->seconds, rhs = ((const struct result *) r)->seconds;
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static void bench(struct workload *workload, unsigned runs, const char *stats) {
+	struct result results[MAX_RUNS];
+	long peak_rss = 0;
+
+	for (unsigned i = 0; i < runs; ++i) {
+		results[i] = run(workload);
+
+		if (peak_rss < results[i].peak_rss)
+			peak_rss = results[i].peak_rss;
+	}
+
+	read_gc_stats(stats, &results[runs - 1]);
+	struct result last = results[runs - 1];
+	qsort(results, runs, sizeof *results, compare_seconds);
+
+	printf("%s\t%u\t%.1f\t%.1f\t%.1f\t%ld\t%lu\t%lu\n", workload->name, runs,
+		results[runs / 2].seconds * 1000, results[0].seconds * 1000, results[runs - 1].seconds * 1000,
+		peak_rss, last.nursery_collections, last.full_collections);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	if (argc != 4) {
+		fprintf(stderr, "usage: %s SQUIRE RUNS WORKLOADS\n", argv[0]);
+		return 1;
+	}
+
+	unsigned runs = strtoul(argv[2], NULL, 10);
+
+	if (runs < 1 || MAX_RUNS < runs) {
+		fprintf(stderr, "%s: RUNS must be between 1 and %d\n", argv[0], MAX_RUNS);
+		return 1;
+	}
+
+	// The workloads run in other directories, so the interpreter's path has to be absolute.
+	char *squire = realpath(argv[1], NULL);
+	if (squire == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	FILE *workloads = fopen(argv[3], "r");
+	if (workloads == NULL) {
+		perror(argv[3]);
+		return 1;
+	}
+
+	char stats[] = "/tmp/squire-bench-XXXXXX";
+	int stats_fd = mkstemp(stats);
+	if (stats_fd < 0) {
+		perror(stats);
+		return 1;
+	}
+	close(stats_fd);
+
+	char gc_stats_option[sizeof stats + 16];
+	snprintf(gc_stats_option, sizeof gc_stats_option, "--gc-stats=%s", stats);
+
+	printf("# name\truns\tmedian_ms\tmin_ms\tmax_ms\tpeak_rss_kb\tnursery_collections\tfull_collections\n");
+
+	char *line = NULL;
+	size_t capacity = 0;
+
+	while (getline(&line, &capacity, workloads) > 0) {
+		struct workload workload = { .argv = { squire, gc_stats_option } };
+		unsigned argc = 2;
+
+		line[strcspn(line, "\n")] = '\0';
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+
+		workload.name = strtok(line, "\t");
+		workload.directory = strtok(NULL, "\t");
+
+		for (char *arg; argc < MAX_ARGS + 2 && (arg = strtok(NULL, " \t"));)
+			workload.argv[argc++] = arg;
+
+		if (workload.directory == NULL) {
+			fprintf(stderr, "%s: malformed workload '%s'\n", argv[3], workload.name);
+			return 1;
+		}
+
+		bench(&workload, runs, stats);
+	}
+
+	unlink(stats);
+	return 0;
+}
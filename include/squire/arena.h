@@ -0,0 +1,39 @@
+#ifndef SQ_ARENA_H
+#define SQ_ARENA_H
+
+#include <stddef.h>
+#include <squire/attributes.h>
+
+/*
+ * Arenas for the variable-length parts of values (such as a book's pages or a codex's
+ * buckets), which are allocated whenever a value is and freed whenever one is swept.
+ *
+ * Sizes up to `SQ_ARENA_MAX_SIZE` are rounded up to a multiple of `SQ_ARENA_CLASS_SIZE`, and
+ * each of those size classes is allocated out of its own blocks. Each block keeps a count of
+ * its live payloads and a free list of its freed ones, and once a block has no live payloads
+ * left it's given back to `malloc` (except for the last block with room in its class). Larger
+ * sizes are just passed along to `malloc`.
+ *
+ * As sizes aren't stored, the size a payload was allocated with must be given to free it.
+ */
+
+#ifndef SQ_ARENA_CLASS_SIZE
+# define SQ_ARENA_CLASS_SIZE 16
+#endif
+
+#ifndef SQ_ARENA_MAX_SIZE
+# define SQ_ARENA_MAX_SIZE 512
+#endif
+
+#ifndef SQ_ARENA_BLOCK_SIZE
+# define SQ_ARENA_BLOCK_SIZE (64 * 1024) // how much is taken from `malloc` for a size class at a time; a power of two
+#endif
+
+// Returns `NULL` when `size` is zero.
+void *sq_arena_malloc(size_t size) SQ_NODISCARD;
+void sq_arena_free(void *payload, size_t size);
+
+// Copies the first `length` bytes of `payload` into a new payload of `new_size` bytes.
+void *sq_arena_realloc(void *payload, size_t size, size_t new_size, size_t length) SQ_NODISCARD;
+
+#endif /* !SQ_ARENA_H */
@@ -108,6 +108,24 @@
 # define SQ_RETURNS_NONNULL
 #endif /* SQ_HAS_ATTRIBUTE(nonnull) */
 
+#if SQ_HAS_BUILTIN(__builtin_prefetch)
+# define SQ_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+# define SQ_PREFETCH(ptr) ((void) (ptr))
+#endif /* SQ_HAS_BUILTIN(__builtin_prefetch) */
+
+#if SQ_HAS_ATTRIBUTE(noinline)
+# define SQ_NOINLINE SQ_ATTR(noinline)
+#else
+# define SQ_NOINLINE
+#endif /* SQ_HAS_ATTRIBUTE(noinline) */
+
+#if SQ_HAS_ATTRIBUTE(no_sanitize_address)
+# define SQ_NO_SANITIZE_ADDRESS SQ_ATTR(no_sanitize_address)
+#else
+# define SQ_NO_SANITIZE_ADDRESS
+#endif /* SQ_HAS_ATTRIBUTE(no_sanitize_address) */
+
 #if SQ_HAS_ATTRIBUTE(nullable)
 # define SQ_NULLABLE SQ_ATTR(nullable)
 #else
@@ -2,6 +2,7 @@
 #define SQ_BASIC_H
 
 #include <squire/attributes.h>
+#include <stdbool.h>
 #include <squire/sqassert.h>
 #include <squire/utils.h>
 #include <squire/valuedecl.h>
@@ -14,17 +15,35 @@
 		"type '" #type "' is too large (" SQ_TO_STRING(SQ_VALUE_SIZE) " bytes max)")
 
 struct sq_basic {
-	unsigned marked: 1;
+	unsigned marked: 1; // only for static values; the gc keeps the rest in a bitmap
 	unsigned in_use: 1;
 	unsigned user1: 1;
 	unsigned user2: 1;
 	enum sq_genus_tag genus: SQ_GENUS_TAG_BITS;
+
+	// Set once a value has survived a collection (or for static values). Old values stay marked
+	// between collections, and are only swept by a full collection.
+	unsigned old: 1;
+
+	// Set when an old value is in the remembered set (see `sq_gc_write_barrier`).
+	unsigned remembered: 1;
+
+	// Set for values allocated into the gc's permanent space (see `sq_gc_begin_permanent`).
+	unsigned permanent: 1;
 };
 
 #define SQ_BASIC_DECLARATION SQ_ALIGNAS(SQ_VALUE_ALIGNMENT) struct sq_basic
 
 #define SQ_STATIC_BASIC(kind) ((struct sq_basic) { .marked = 0, .in_use = 1, \
-	.genus = SQ_TAG_FOR(kind) })
-#define SQ_GUARD_MARK(what) do { if ((what)->basic.marked) return; (what)->basic.marked = 1; } while(0)
+	.old = 1, .genus = SQ_TAG_FOR(kind) })
+
+/* Queues `basic` to be marked, returning whether its mark function should return early.
+ *
+ * Marking doesn't recurse: a value's mark function is first called to push it onto the gc's
+ * mark stack (if it's not already marked), and then called again by the gc when it's popped
+ * off, at which point this returns `false` so its children are pushed. (This is in `gc.c`.)
+ */
+bool sq_gc_mark(struct sq_basic *basic);
+#define SQ_GUARD_MARK(what) do { if (sq_gc_mark(&(what)->basic)) return; } while(0)
 
 #endif
@@ -2,6 +2,7 @@
 
 #include <squire/value.h>
 #include <squire/shared.h>
+#include <squire/arena.h>
 
 #include <stddef.h>
 #include <stdalign.h>
@@ -14,20 +15,39 @@
 struct sq_book {
 	SQ_BASIC_DECLARATION basic;
 
+	/* Whether there are any unused pages before `pages`; this lets `pages` be inserted
+	 * and deleted at the front without having to move every other page. How many there
+	 * are is a `size_t`, which doesn't fit alongside the other fields, so it's kept in
+	 * the unused page right before `pages` (see `sq_book_front`). */
+	bool has_front;
+
 	/* The pages associated with this book. */
 	sq_value *pages;
 
 	/* How many pages are in this book. */
 	size_t length;
 
-	/* How many pages the book can hold before reallocating. */
+	/* How many pages the book can hold, starting at `pages`, before reallocating. */
 	size_t capacity;
 };
+/* Set when every page is known to be a numeral. Such books don't need their
+ * pages marked, and can be compared and sorted without looking at tags. */
+#define sq_book_is_numerals basic.user1
+/* Set by `sq_book_sort` while it's arranging the book, and cleared whenever the book
+ * is changed, so it can tell whether its comparator changed the book. */
+#define sq_book_is_unchanged basic.user2
 SQ_VALUE_ASSERT_SIZE(struct sq_book);
+SQ_STATIC_ASSERT(sizeof(size_t) <= sizeof(sq_value), "the front's length fits in a page");
+
+// How many unused pages are before `book->pages`.
+static inline size_t sq_book_front(const struct sq_book *book) {
+	return book->has_front ? (size_t) book->pages[-1] : 0;
+}
 
 /** Creates a new book from the given `length`, `capacity`, and `pages`.
  *
- * Note that `length` should be less than or equal to `capacity`.
+ * Note that `length` should be less than or equal to `capacity`, and that `pages` must be
+ * from `sq_arena_malloc`, with room for `capacity` pages.
  */
 struct sq_book *sq_book_new(size_t length, size_t capacity, sq_value *pages);
 
@@ -38,10 +58,21 @@ static inline struct sq_book *sq_book_new2(size_t length, sq_value *pages) {
 
 // Creates a new book with the given capacity.
 static inline struct sq_book *sq_book_allocate(size_t capacity) {
-	return sq_book_new(0, capacity, sq_malloc_vec(sq_value, capacity));
+	return sq_book_new(0, capacity, sq_arena_malloc(sq_sizeof_array(sq_value, capacity)));
+}
+
+// Appends `value` to `book`, which must already have the capacity for it.
+static inline void sq_book_push(struct sq_book *book, sq_value value) {
+	sq_assert_lt(book->length, book->capacity);
+
+	sq_gc_write_barrier(&book->basic, value);
+	book->sq_book_is_numerals &= sq_value_is_numeral(value);
+	book->sq_book_is_unchanged = 0;
+	book->pages[book->length++] = value;
 }
 
 void sq_book_mark(struct sq_book *book);
+void sq_book_relocate(struct sq_book *book);
 void sq_book_deallocate(struct sq_book *book);
 
 /** Inserts `value` at the given index.
@@ -119,4 +150,12 @@ struct sq_book *sq_book_map(const struct sq_book *book, const struct sq_journey
 struct sq_book *sq_book_select(const struct sq_book *book, const struct sq_journey *func);
 sq_value sq_book_reduce(const struct sq_book *book, const struct sq_journey *func);
 
+/** Stably sorts `book` in place.
+ *
+ * If `comparator` is `SQ_NI`, pages are compared with `sq_value_cmp`; otherwise,
+ * it's called with two pages and should return a numeral less than, equal to, or
+ * greater than zero. If the comparator changes `book`, an exception is thrown.
+ */
+void sq_book_sort(struct sq_book *book, sq_value comparator);
+
 #endif /* !SQ_BOOK_H */
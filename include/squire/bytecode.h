@@ -43,6 +43,8 @@ enum sq_interrupt {
 	SQ_INT_ARRAY_INSERT = SQ_INTERRUPT(3,  1), // [A,B,C,DST] A.insert(len=B,pos=C); (Stores in DST, though this is not intended)
 	SQ_INT_ARRAY_DELETE = SQ_INTERRUPT(2,  0), // [A,B,DST] DST <- A.delete(B)
 	SQ_INT_BABEL        = SQ_INTERRUPT(2,  2), // [A,...,B,DST] DST <- babel(exec=A,stdin=B,args=...)
+	SQ_INT_SORT         = SQ_INTERRUPT(1, 17), // [A,DST] DST <- A, after sorting A in place
+	SQ_INT_SORT_BY      = SQ_INTERRUPT(2,  4), // [A,B,DST] DST <- A, after sorting A in place using B as the comparator
 
 	SQ_INT_ARABIC       = SQ_INTERRUPT(1,  8), // [A,DST] DST <- A.to_numeral().arabic()
 	SQ_INT_ROMAN        = SQ_INTERRUPT(1,  9), // [A,DST] DST <- A.to_numeral().roman()
@@ -0,0 +1,28 @@
+#ifndef SQ_CENSUS_H
+#define SQ_CENSUS_H
+
+#include <stdio.h>
+#include <signal.h>
+
+/** Writes a census of the heap to `out`: how many live values there are, and how many bytes
+ * they use outside of the heap, by genus, by form (for imitations) and by allocation site.
+ *
+ * Every line is tab separated and they're sorted, so two censuses can be diffed. Sites are
+ * only counted if the gc was configured with `allocation-sites`.
+ */
+void sq_census_write(FILE *out);
+
+// Set by `SIGUSR1`; the interpreter takes a census the next time it's safe to.
+extern volatile sig_atomic_t sq_census_requested;
+
+/** Takes a census whenever `SIGUSR1` is received.
+ *
+ * If `prefix` isn't `NULL`, each is written to `prefix.1`, `prefix.2`, and so on; otherwise
+ * they're written to stderr.
+ */
+void sq_census_on_signal(const char *prefix);
+
+// Writes the census requested by `SIGUSR1`.
+void sq_census_take_requested(void);
+
+#endif /* !SQ_CENSUS_H */
@@ -2,18 +2,29 @@
 
 #include <squire/value.h>
 
+/*
+ * Pages are kept in insertion order, even across deletions, and are indexed by an
+ * open-addressed table of `buckets`.
+ *
+ * `capacity` is always a power of two, and there are always `capacity * 2` buckets; each
+ * bucket is either `0` (empty) or one more than the index of the page it refers to.
+ */
 struct sq_codex {
 	SQ_BASIC_DECLARATION basic;
 	struct sq_codex_page *pages;
 	unsigned length, capacity;
+	unsigned *buckets;
 };
 SQ_VALUE_ASSERT_SIZE(struct sq_codex);
 
 struct sq_codex_page {
 	sq_value key, value;
+	sq_hash hash; // the `sq_value_hash` of `key`.
 };
 
 struct sq_codex *sq_codex_allocate(unsigned capacity);
+
+// `pages` must be from `sq_arena_malloc`, with room for `capacity` pages.
 struct sq_codex *sq_codex_new(unsigned length, unsigned capacity, struct sq_codex_page *pages);
 
 static inline struct sq_codex *sq_codex_new2(unsigned length, struct sq_codex_page *pages) {
@@ -21,6 +32,7 @@ static inline struct sq_codex *sq_codex_new2(unsigned length, struct sq_codex_pa
 }
 
 void sq_codex_mark(struct sq_codex *codex);
+void sq_codex_relocate(struct sq_codex *codex);
 void sq_codex_deallocate(struct sq_codex *codex);
 
 struct sq_text *sq_codex_to_text(const struct sq_codex *codex);
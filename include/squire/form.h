@@ -67,7 +67,10 @@ SQ_VALUE_ASSERT_SIZE(struct sq_form);
 struct sq_imitation {
 	SQ_BASIC_DECLARATION basic;
 	struct sq_form *form;
-	sq_value *matter;
+	sq_value *matter; // allocated with `sq_arena_malloc`
+
+	// How many values `matter` has room for; the form may already be freed when this is.
+	unsigned nmatter;
 };
 SQ_VALUE_ASSERT_SIZE(struct sq_imitation);
 
@@ -78,6 +81,7 @@ SQ_VALUE_ASSERT_SIZE(struct sq_imitation);
 struct sq_form *sq_form_new(char *name);
 
 void sq_form_mark(struct sq_form *form);
+void sq_form_relocate(struct sq_form *form);
 void sq_form_deallocate(struct sq_form *form);
 
 /** Prints a debug representation of `form` to `out`. */
@@ -116,7 +120,8 @@ struct sq_imitation *sq_form_imitate(struct sq_form *form, struct sq_args args);
  * Creates a new imitation (instance) for the given `form`, with the given
  * fields.
  * 
- * Note that ownership of both `form`'s and `fields`'s transferred.
+ * Note that ownership of both `form`'s and `fields`'s transferred; `fields` must be from
+ * `sq_arena_malloc`.
  */
 struct sq_imitation *sq_imitation_new(struct sq_form *form, sq_value *fields);
 
@@ -141,6 +146,7 @@ struct sq_journey *sq_imitation_lookup_change(struct sq_imitation *imitation, co
 sq_value sq_imitation_get_attr(struct sq_imitation *imitation, const char *name);
 bool sq_imitation_set_attr(struct sq_imitation *imitation, const char *name, sq_value value);
 void sq_imitation_mark(struct sq_imitation *imitation);
+void sq_imitation_relocate(struct sq_imitation *imitation);
 void sq_imitation_deallocate(struct sq_imitation *imitation);
 
 /** Prints a debug representation of `imitation` to `out`. */
@@ -2,11 +2,189 @@
 #define SQ_GC_H
 
 #include <squire/program.h>
+#include <squire/basic.h>
 #include <squire/valuedecl.h>
+#include <stdio.h>
+#include <stdint.h>
 
-void sq_gc_init(long long heap_size, struct sq_program *program);
-void sq_gc_start(void);
+/*
+ * The garbage collector is generational: new values are allocated into a nursery, which is
+ * collected on its own whenever it fills up. Values that survive are promoted to the old
+ * generation, which is only collected when it has grown enough since the last full collection
+ * (or when the heap is exhausted).
+ *
+ * Values a program is compiled into are allocated into a permanent space outside the heap
+ * instead. They're never swept, and always count as marked, so they're only traced once
+ * they've been changed.
+ *
+ * Besides the program's globals and stackframes, the C stack is scanned conservatively, so
+ * values that are only referenced by C locals are kept alive.
+ *
+ * Values are only moved by compaction, which slides the heap's live values together once a
+ * full collection finds enough of it is holes. As the C stack can't be rewritten, values it
+ * seems to reference are pinned where they are, as are codex keys hashed by their address.
+ *
+ * When built with `SQ_GC_MARK_THREADS` above one (and `-pthread`), large collections are
+ * marked by that many threads at once.
+ */
+
+#ifndef SQ_GC_NURSERY_SIZE
+# define SQ_GC_NURSERY_SIZE 65536 // how many values are allocated between nursery collections
+#endif
+
+#ifndef SQ_GC_INITIAL_HEAP
+# define SQ_GC_INITIAL_HEAP (4 << 20) // in bytes
+#endif
+
+#ifndef SQ_GC_MAXIMUM_HEAP
+# define SQ_GC_MAXIMUM_HEAP (64ULL << 30) // in bytes; only address space is reserved up front
+#endif
+
+#ifndef SQ_GC_HEAP_GROWTH
+# define SQ_GC_HEAP_GROWTH 2.0
+#endif
+
+#ifndef SQ_GC_COMPACT_THRESHOLD
+# define SQ_GC_COMPACT_THRESHOLD 50 // compact once this percent of the used heap is holes; 0 never does
+#endif
+
+// How the heap's memory is backed; these can be combined.
+enum sq_gc_backing {
+	SQ_GC_HUGE_PAGES = 1, // ask for transparent huge pages, so marking and sweeping miss the TLB less
+	SQ_GC_PREFAULT = 2 // fault memory in as soon as it's committed, rather than when it's first used
+};
+
+#ifndef SQ_GC_BACKING
+# define SQ_GC_BACKING 0
+#endif
+
+struct sq_gc_config {
+	size_t initial_heap, maximum_heap; // in bytes
+	double heap_growth; // how much bigger the heap gets each time it grows
+	unsigned compact_threshold; // in percent
+	bool allocation_sites; // whether to record where each value was allocated, for censuses
+	unsigned backing; // a combination of `sq_gc_backing`s
+	bool deduplicate_texts; // whether texts which survive a full collection are deduplicated
+	size_t sweep_budget; // how many words of the allocation bitmap are lazily swept at a time
+};
+
+// Must be configured before `sq_gc_init` is called.
+extern struct sq_gc_config sq_gc_config;
+
+/** Sets the option `name` (`heap-initial`, `heap-max`, `heap-growth`, `compact-threshold`,
+ * `allocation-sites`, `heap-backing`, `dedup-texts` or `sweep-budget`) from `value`.
+ *
+ * Sizes can end with `k`, `m` or `g`, `allocation-sites` and `dedup-texts` are `0` or `1`,
+ * `heap-backing` is `default` or a comma separated list of `huge` and `prefault`, and
+ * `sweep-budget` is a positive number of bitmap words (each of which covers 64 values). Returns
+ * false if `name` or `value` is invalid.
+ */
+bool sq_gc_configure(const char *name, const char *value);
+
+// How many buckets the histogram of collection pauses has (see `struct sq_gc_stats`).
+#define SQ_GC_PAUSE_BUCKETS 6
+
+// Counters which the gc always keeps, for sizing heaps.
+struct sq_gc_stats {
+	size_t nursery_collections, full_collections, compactions;
+
+	// `pauses[i]` counts collections which took under `10^(i+2)` microseconds (ie 100us, 1ms,
+	// ...); the last bucket counts all the ones that took longer.
+	size_t pauses[SQ_GC_PAUSE_BUCKETS];
+	uint64_t total_pause, longest_pause; // in nanoseconds
+
+	size_t allocated[1 << SQ_GENUS_TAG_BITS]; // how many values of each genus the heap allocated
+	size_t permanent; // how many values were allocated into the permanent space
+
+	size_t moved; // how many values compaction moved
+	size_t deduplicated, deduplicated_bytes; // texts made to share their contents, and bytes saved
+	size_t live, peak_live; // values in the heap which haven't been freed yet
+	size_t committed; // how many bytes of the heap are usable
+};
+
+// What `pauses` and `allocated` are called when the counters are written out.
+extern const char *const sq_gc_pause_names[SQ_GC_PAUSE_BUCKETS];
+extern const char *const sq_gc_genus_names[1 << SQ_GENUS_TAG_BITS];
+
+// Fills in `stats` with the gc's current counters.
+void sq_gc_read_stats(struct sq_gc_stats *stats);
+
+// Writes the gc's counters to `out` as a JSON object.
+void sq_gc_dump_stats(FILE *out);
+
+void sq_gc_init(struct sq_program *program);
+void sq_gc_start(void); // runs a full collection
 void sq_gc_teardown(void);
 void *sq_gc_malloc(enum sq_genus_tag genus); // allocates enough to store one value
 
-#endif 
+// Collections are postponed while paused, eg while values that have been allocated aren't
+// yet reachable from any roots. These nest.
+void sq_gc_pause(void);
+void sq_gc_resume(void);
+
+// Set when the gc has work which it can only do at a safepoint (see `sq_gc_safepoint`).
+extern bool sq_gc_safepoint_pending;
+
+/** Does the work which the gc postponed until a safepoint: compacting the heap, and
+ * deduplicating texts.
+ *
+ * As they can't be rewritten, this must only be called when no values are referenced from
+ * anywhere but the roots and the C stack (eg a copy of a book's pages being sorted), and no
+ * text's contents are referenced by anything but the text.
+ */
+void sq_gc_safepoint(void);
+
+// Slides the heap's live values together, after collecting everything. Only at safepoints.
+void sq_gc_compact(void);
+
+// Makes old texts which are the same share their contents. Only at safepoints.
+void sq_gc_deduplicate_texts(void);
+
+/** Where `ptr` was moved to by the running compaction.
+ *
+ * Every reference is rewritten before any value is moved, so rewritten ones mustn't be
+ * followed.
+ */
+void *sq_gc_relocated(void *ptr);
+void sq_gc_relocate(sq_value *value);
+
+// The instruction that was running when a value was allocated; `journey` is `NULL` for values
+// allocated outside of any journey.
+struct sq_gc_site {
+	const struct sq_journey *journey;
+	unsigned ip;
+};
+
+/** Calls `visit` with each live value in the heap, after collecting everything.
+ *
+ * `site` is where the value was allocated, or `NULL` unless `allocation-sites` was configured.
+ * `visit` mustn't allocate any values.
+ */
+void sq_gc_each_live(void (*visit)(sq_value value, const struct sq_gc_site *site, void *data),
+	void *data);
+
+// Values allocated between these are permanent, and are never freed. These nest.
+void sq_gc_begin_permanent(void);
+void sq_gc_end_permanent(void);
+
+void sq_gc_remember(struct sq_basic *parent);
+
+/** Must be called whenever `value` is stored into the value `parent`.
+ *
+ * When an old value is made to reference a young one, the old value is remembered so that
+ * the nursery can be collected without marking the entire old generation. Permanent values
+ * are remembered for good the first time they're changed, whatever they're made to reference.
+ */
+static inline void sq_gc_write_barrier(struct sq_basic *parent, sq_value value) {
+	if (SQ_LIKELY(!parent->old || parent->remembered))
+		return;
+
+	// numerals and `ni`/`yea`/`nay` aren't allocated.
+	if (sq_value_genus_tag(value) == SQ_G_NUMERAL || value <= SQ_UNDEFINED)
+		return;
+
+	if (SQ_UNLIKELY(parent->permanent) || !((struct sq_basic *) SQ_VUNMASK(value))->old)
+		sq_gc_remember(parent);
+}
+
+#endif
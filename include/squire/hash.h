@@ -0,0 +1,44 @@
+#ifndef SQ_HASH_H
+#define SQ_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <squire/attributes.h>
+
+/*
+ * Hashes are 32 bits wide so that they can be cached inside of values (such as
+ * `struct sq_text`) without growing them past `SQ_VALUE_SIZE`.
+ *
+ * A hash of `0` is never returned, so it can be used to mean "not computed yet".
+ */
+typedef uint32_t sq_hash;
+
+// Hashes `length` bytes starting at `ptr`.
+sq_hash sq_hash_bytes(const void *ptr, size_t length) SQ_NODISCARD;
+
+static inline sq_hash sq_hash_finish(uint64_t hash) SQ_NODISCARD;
+static inline sq_hash sq_hash_finish(uint64_t hash) {
+	// murmur3's finalizer, then folded down to 32 bits.
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+
+	sq_hash folded = (sq_hash) (hash ^ (hash >> 32));
+	return folded + !folded;
+}
+
+// Hashes a single integer.
+static inline sq_hash sq_hash_integer(uint64_t integer) SQ_NODISCARD;
+static inline sq_hash sq_hash_integer(uint64_t integer) {
+	return sq_hash_finish(integer);
+}
+
+// Mixes `hash` into `seed`; used to hash containers, and is order-dependent.
+static inline sq_hash sq_hash_combine(sq_hash seed, sq_hash hash) SQ_NODISCARD;
+static inline sq_hash sq_hash_combine(sq_hash seed, sq_hash hash) {
+	return sq_hash_finish(((uint64_t) seed << 32) | hash);
+}
+
+#endif /* !SQ_HASH_H */
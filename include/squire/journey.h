@@ -14,15 +14,26 @@ struct sq_args {
 
 #define SQ_JOURNEY_MAX_ARGC 32 // seems like a reasonable maximum
 
+/*
+ * The instructions during which a local may hold a value that's still needed: those with
+ * `start <= ip <= end`. Temporaries are only live within the statement that created them, so
+ * the gc doesn't keep them alive once it's finished; named variables are always live.
+ */
+struct sq_live_range {
+	unsigned start, end;
+};
+
 struct sq_codeblock {
 	unsigned nlocals, nconsts, codelen;
 	sq_value *consts;
 	union sq_bytecode *bytecode;
+	struct sq_live_range *live; // one for each local, or `NULL` if they're all always live.
 };
 
 struct sq_journey_argument {
 	char *name;
-	int default_start, genus_start; // will be `-1` if no default or genus is supplied.
+	// will be `-1` if no default or genus is supplied. a genus's code returns whether it matches.
+	int default_start, genus_start;
 };
 
 struct sq_journey_pattern {
@@ -58,10 +69,39 @@ extern unsigned sq_current_stackframe;
 
 void sq_stackframe_mark(struct sq_stackframe *stackframe);
 void sq_journey_mark(struct sq_journey *journey);
+void sq_stackframe_relocate(struct sq_stackframe *stackframe);
+void sq_journey_relocate(struct sq_journey *journey);
 void sq_journey_deallocate(struct sq_journey *journey);
 
 sq_value sq_journey_run(const struct sq_journey *journey, struct sq_args args);
 
+#ifndef SQ_JOURNEY_CALL_INLINE_LOCALS
+# define SQ_JOURNEY_CALL_INLINE_LOCALS 16
+#endif /* !SQ_JOURNEY_CALL_INLINE_LOCALS */
+
+/*
+ * A call to a journey that's been prepared ahead of time, so it can be invoked many
+ * times (such as once per page of a book) without redoing per-call work.
+ *
+ * Preparing a call skips the patterns that can never match its argument count and,
+ * if the first one that can has no genuses or condition, resolves it once for every
+ * invocation. The locals of the journey's frame are also allocated only once, though an
+ * invocation made while the call is already `active` (ie the journey re-entered it) gets
+ * its own locals, as the outer invocation's are still in use.
+ */
+struct sq_journey_call {
+	const struct sq_journey *journey;
+	const struct sq_journey_pattern *pattern; // `NULL` if patterns must be matched each time.
+	unsigned pargc, first_pattern, nlocals;
+	unsigned active; // how many invocations are running; not decremented if one throws.
+	sq_value *locals;
+	sq_value inline_locals[SQ_JOURNEY_CALL_INLINE_LOCALS];
+};
+
+void sq_journey_call_prepare(struct sq_journey_call *call, const struct sq_journey *journey, unsigned pargc);
+sq_value sq_journey_call_invoke(struct sq_journey_call *call, sq_value *pargv);
+void sq_journey_call_finish(struct sq_journey_call *call);
+
 static inline void sq_journey_assert_arglen(struct sq_args args, unsigned pargc, unsigned kwargc) {
 	if (args.pargc != pargc || args.kwargc != kwargc)
 		sq_throw("Argument mismatch: given (pos=%d, kw=%d) expected (pos=%d,kw=%d)",
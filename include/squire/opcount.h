@@ -0,0 +1,98 @@
+#ifndef SQ_OPCOUNT_H
+#define SQ_OPCOUNT_H
+
+/*
+ * When built with `SQ_COUNT_OPCODES`, the interpreter counts how many times each opcode and
+ * interrupt is run, and how often each opcode directly follows another. When also built with
+ * `SQ_COUNT_OPCODE_CYCLES`, it counts the cycles spent in each of them, up until the next one
+ * starts (so a call's cycles only include the call itself). Without them, counting compiles
+ * to nothing.
+ */
+
+#include <squire/bytecode.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Opcodes and interrupts are both below this, as their ids are less than 32.
+#define SQ_OPCOUNT_SLOTS (1 << (SQ_OPCODE_SHIFT_AMOUNT + 5))
+SQ_STATIC_ASSERT(SQ_OPCODE_SHIFT_AMOUNT == SQ_INTERRUPT_SHIFT_AMOUNT, "slots are shared");
+
+#ifndef SQ_OPCOUNT_PAIRS_SHOWN
+# define SQ_OPCOUNT_PAIRS_SHOWN 32 // how many of the most common pairs are written
+#endif
+
+#if defined(SQ_COUNT_OPCODE_CYCLES) && !defined(SQ_COUNT_OPCODES)
+# define SQ_COUNT_OPCODES
+#endif
+
+#ifdef SQ_COUNT_OPCODES
+# ifdef SQ_COUNT_OPCODE_CYCLES
+#  if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#   define sq_opcount_now() ((uint64_t) __rdtsc())
+#  else
+#   include <time.h>
+static inline uint64_t sq_opcount_now(void) {
+	// Without a cycle counter, nanoseconds are counted instead.
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+#  endif
+# endif /* SQ_COUNT_OPCODE_CYCLES */
+
+struct sq_opcount {
+	size_t opcodes[SQ_OPCOUNT_SLOTS], interrupts[SQ_OPCOUNT_SLOTS];
+	size_t pairs[SQ_OPCOUNT_SLOTS][SQ_OPCOUNT_SLOTS]; // indexed by the first opcode, then the second
+	enum sq_opcode previous;
+# ifdef SQ_COUNT_OPCODE_CYCLES
+	uint64_t opcode_cycles[SQ_OPCOUNT_SLOTS], interrupt_cycles[SQ_OPCOUNT_SLOTS];
+	uint64_t *running, started; // what the cycles since `started` will be counted towards
+# endif /* SQ_COUNT_OPCODE_CYCLES */
+};
+
+extern struct sq_opcount sq_opcount;
+
+# ifdef SQ_COUNT_OPCODE_CYCLES
+// Counts the cycles since the last opcode or interrupt started towards it, then starts counting
+// towards `cycles`.
+static inline void sq_opcount_start(uint64_t *cycles) {
+	uint64_t now = sq_opcount_now();
+
+	if (sq_opcount.running != NULL)
+		*sq_opcount.running += now - sq_opcount.started;
+
+	sq_opcount.running = cycles;
+	sq_opcount.started = now;
+}
+# endif /* SQ_COUNT_OPCODE_CYCLES */
+
+static inline void sq_count_opcode(enum sq_opcode opcode) {
+	++sq_opcount.opcodes[opcode];
+	++sq_opcount.pairs[sq_opcount.previous][opcode];
+	sq_opcount.previous = opcode;
+
+# ifdef SQ_COUNT_OPCODE_CYCLES
+	sq_opcount_start(&sq_opcount.opcode_cycles[opcode]);
+# endif /* SQ_COUNT_OPCODE_CYCLES */
+}
+
+static inline void sq_count_interrupt(enum sq_interrupt interrupt) {
+	++sq_opcount.interrupts[interrupt];
+
+# ifdef SQ_COUNT_OPCODE_CYCLES
+	sq_opcount_start(&sq_opcount.interrupt_cycles[interrupt]);
+# endif /* SQ_COUNT_OPCODE_CYCLES */
+}
+
+/** Writes every opcode and interrupt that was run, and the most common pairs of opcodes, to
+ * `out`. Each section is sorted by how many times they were run, and is tab separated.
+ */
+void sq_opcount_write(FILE *out);
+#else
+# define sq_count_opcode(opcode) ((void) 0)
+# define sq_count_interrupt(interrupt) ((void) 0)
+#endif /* SQ_COUNT_OPCODES */
+
+#endif /* !SQ_OPCOUNT_H */
@@ -20,4 +20,7 @@ void sq_kingdom_deallocate(struct sq_kingdom *kingdom);
 sq_value sq_kingdom_get_attr(const struct sq_kingdom *kingdom, const char *attr);
 bool sq_kingdom_set_attr(struct sq_kingdom *kingdom, const char *attr, sq_value value);
 
+// Creates the `Gc` kingdom, through which scripts can read the gc's counters and collect.
+struct sq_other *sq_gc_kingdom_new(void);
+
 #endif /* !SQ_KINGDOM_H */
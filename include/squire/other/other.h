@@ -80,6 +80,7 @@ static inline struct sq_pattern_helper *sq_other_as_pattern_helper(struct sq_oth
 
 void sq_other_dump(FILE *out, const struct sq_other *other);
 void sq_other_mark(struct sq_other *other);
+void sq_other_relocate(struct sq_other *other);
 void sq_other_deallocate(struct sq_other *other);
 const char *sq_other_typename(const struct sq_other *other);
 sq_value sq_other_genus(const struct sq_other *other);
@@ -0,0 +1,34 @@
+#ifndef SQ_PROFILE_H
+#define SQ_PROFILE_H
+
+#include <stdio.h>
+
+#ifndef SQ_PROFILE_INTERVAL
+# define SQ_PROFILE_INTERVAL 10000 // in microseconds of cpu time between samples
+#endif
+
+#ifndef SQ_PROFILE_MAX_DEPTH
+# define SQ_PROFILE_MAX_DEPTH 128 // deeper stacks only keep their innermost stackframes
+#endif
+
+#ifndef SQ_PROFILE_MAX_STACKS
+# define SQ_PROFILE_MAX_STACKS 16384 // distinct stacks recorded; further ones are dropped
+#endif
+
+/** Starts sampling which journeys are running, using `SIGPROF`.
+ *
+ * Each sample records every stackframe's journey and `ip`, and is counted in a table that's
+ * allocated up front, so taking one never allocates. The samples are written to `path` when
+ * the program exits.
+ */
+void sq_profile_start(const char *path);
+
+/** Writes the samples taken so far to `out`, in the collapsed format flame graph tools read.
+ *
+ * Each line is a stack of `name@ip` frames, outermost first and separated by `;`, followed by
+ * how many samples it was seen in. As there aren't source lines to resolve `ip`s to, they're
+ * left as bytecode indices, like in censuses. Samples that didn't fit are counted as `<dropped>`.
+ */
+void sq_profile_write(FILE *out);
+
+#endif /* !SQ_PROFILE_H */
@@ -11,6 +11,7 @@ struct sq_program {
 
 void sq_program_initialize(struct sq_program *);
 void sq_program_mark(struct sq_program *);
+void sq_program_relocate(struct sq_program *);
 void sq_program_compile(struct sq_program *program, const char *stream);
 void sq_program_run(struct sq_program *program, unsigned argc, const char **argv);
 void sq_program_finish(struct sq_program *program);
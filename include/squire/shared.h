@@ -63,6 +63,17 @@ void *sq_calloc(size_t count, size_t size)
 	;
 
 void *sq_realloc(void *ptr, size_t size) SQ_NODISCARD;
+
+// `size` must be a multiple of `alignment`, which must be a power of two.
+void *sq_malloc_aligned(size_t alignment, size_t size)
+	SQ_NODISCARD
+#if SQ_HAS_ATTRIBUTE(malloc)
+	SQ_ATTR(malloc)
+#endif
+#if SQ_HAS_ATTRIBUTE(alloc_size)
+	SQ_ATTR(alloc_size(2))
+#endif
+	;
 void *sq_memdup(void *ptr, size_t size) SQ_NODISCARD;
 
 SQ_NORETURN void sq_internal_bug_fn(const char *file, const char *fn, size_t line, const char *fmt, ...)
@@ -3,13 +3,18 @@
 
 #include <string.h>
 #include <squire/value.h>
+#include <squire/hash.h>
 
 struct sq_text {
 	SQ_BASIC_DECLARATION basic;
+	sq_hash hash; // cached by `sq_text_hash`; `0` if it hasn't been computed yet.
 	char *ptr;
 	unsigned length;
 };
 SQ_VALUE_ASSERT_SIZE(struct sq_text);
+/* Set once a text has been deduplicated; its `ptr` is then shared with every other
+ * deduplicated text that's the same, and is owned by them all rather than by it. */
+#define sq_text_is_deduplicated basic.user1
 
 extern struct sq_text sq_text_empty;
 
@@ -29,10 +34,23 @@ static inline struct sq_text *sq_text_new(char *ptr) {
 	// TODO: init basic
 
 static inline void sq_text_mark(struct sq_text *string) {
-	string->basic.marked = 1;
+	SQ_GUARD_MARK(string);
 }
 
 void sq_text_deallocate(struct sq_text *string);
+
+/** Makes `text` share its contents with any other deduplicated text that's the same.
+ *
+ * Nothing may be holding onto `text->ptr` itself. Returns how many bytes were freed.
+ */
+size_t sq_text_deduplicate(struct sq_text *text);
+
+sq_hash sq_text_hash_slow(struct sq_text *text) SQ_NODISCARD;
+static inline sq_hash sq_text_hash(struct sq_text *text) SQ_NODISCARD;
+static inline sq_hash sq_text_hash(struct sq_text *text) {
+	return SQ_LIKELY(text->hash) ? text->hash : sq_text_hash_slow(text);
+}
+
 void sq_text_combine(const struct sq_text *lhs, const struct sq_text *rhs);
 void sq_text_dump(FILE *out, const struct sq_text *text);
 char *sq_text_to_c_str(const struct sq_text *text);
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <squire/numeral.h>
 #include <squire/basic.h>
+#include <squire/hash.h>
 
 #include <squire/valuedecl.h>
 
@@ -178,6 +179,16 @@ static inline bool sq_value_neq(sq_value lhs, sq_value rhs) {
 	return !sq_value_eql(lhs, rhs);
 }
 
+/*
+ * Hashes `value`, such that values which are `sq_value_eql` have the same hash.
+ *
+ * Books and codices are hashed by their contents, so they shouldn't be changed while
+ * they're being used as codex keys. Imitations use their `hash` change if they have
+ * one, and are otherwise hashed by identity---so forms which define `==` should also
+ * define `hash`.
+ */
+sq_hash sq_value_hash(sq_value value) SQ_NODISCARD;
+
 sq_numeral sq_value_cmp(sq_value lhs, sq_value rhs) SQ_NODISCARD;
 static inline bool sq_value_lth(sq_value lhs, sq_value rhs) SQ_NODISCARD;
 static inline bool sq_value_lth(sq_value lhs, sq_value rhs) {
@@ -200,6 +211,7 @@ static inline bool sq_value_geq(sq_value lhs, sq_value rhs) {
 }
 
 void sq_value_mark(sq_value value);
+void sq_value_relocate(sq_value value);
 void sq_value_deallocate(sq_value value);
 
 sq_value sq_value_neg(sq_value arg) SQ_NODISCARD;
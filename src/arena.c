@@ -0,0 +1,172 @@
+#include <squire/arena.h>
+#include <squire/shared.h>
+#include <string.h>
+
+SQ_STATIC_ASSERT(SQ_ARENA_CLASS_SIZE % SQ_VALUE_ALIGNMENT == 0, "classes must stay aligned");
+SQ_STATIC_ASSERT(SQ_ARENA_MAX_SIZE % SQ_ARENA_CLASS_SIZE == 0, "max size must be a class");
+SQ_STATIC_ASSERT((SQ_ARENA_BLOCK_SIZE & (SQ_ARENA_BLOCK_SIZE - 1)) == 0, "blocks must be a power of two");
+
+#define NCLASSES (SQ_ARENA_MAX_SIZE / SQ_ARENA_CLASS_SIZE)
+
+struct free_payload {
+	struct free_payload *next;
+};
+
+/*
+ * Blocks are aligned to their size, so a payload's block is found just by masking its address.
+ * Each block starts with this header, and its payloads are handed out from `free` first and then
+ * from `bump`. Once `live` drops to zero, the block goes back to `malloc`.
+ */
+struct block {
+	struct block *prev, *next; // within its class's `open` list, if it has room
+	struct free_payload *free;
+	char *bump;
+	size_t live;
+	struct size_class *class;
+};
+
+#define HEADER_SIZE \
+	((sizeof(struct block) + SQ_ARENA_CLASS_SIZE - 1) / SQ_ARENA_CLASS_SIZE * SQ_ARENA_CLASS_SIZE)
+
+SQ_STATIC_ASSERT(HEADER_SIZE + SQ_ARENA_MAX_SIZE <= SQ_ARENA_BLOCK_SIZE, "blocks must fit a payload");
+
+static struct size_class {
+	struct block *open; // the blocks with room for another payload
+} classes[NCLASSES];
+
+static inline struct size_class *class_for(size_t size) {
+	return &classes[(size - 1) / SQ_ARENA_CLASS_SIZE];
+}
+
+static inline size_t class_size(const struct size_class *class) {
+	return (size_t) (class - classes + 1) * SQ_ARENA_CLASS_SIZE;
+}
+
+static inline struct block *block_of(void *payload) {
+	return (struct block *) ((uintptr_t) payload & ~(uintptr_t) (SQ_ARENA_BLOCK_SIZE - 1));
+}
+
+static inline bool has_room(const struct block *block) {
+	return block->free != NULL
+		|| class_size(block->class) <= (size_t) ((const char *) block + SQ_ARENA_BLOCK_SIZE - block->bump);
+}
+
+static void link_block(struct size_class *class, struct block *block) {
+	block->prev = NULL;
+	block->next = class->open;
+
+	if (class->open != NULL)
+		class->open->prev = block;
+
+	class->open = block;
+}
+
+static void unlink_block(struct size_class *class, struct block *block) {
+	if (block->prev != NULL)
+		block->prev->next = block->next;
+	else
+		class->open = block->next;
+
+	if (block->next != NULL)
+		block->next->prev = block->prev;
+}
+
+static struct block *open_block(struct size_class *class) {
+	struct block *block = sq_malloc_aligned(SQ_ARENA_BLOCK_SIZE, SQ_ARENA_BLOCK_SIZE);
+
+	block->free = NULL;
+	block->bump = (char *) block + HEADER_SIZE;
+	block->live = 0;
+	block->class = class;
+
+	link_block(class, block);
+	return block;
+}
+
+void *sq_arena_malloc(size_t size) {
+	if (size == 0)
+		return NULL;
+
+	if (SQ_ARENA_MAX_SIZE < size)
+		return sq_malloc_heap(size);
+
+	struct size_class *class = class_for(size);
+	struct block *block = class->open;
+
+	if (SQ_UNLIKELY(block == NULL))
+		block = open_block(class);
+
+	void *payload;
+
+	if (block->free != NULL) {
+		payload = block->free;
+		block->free = block->free->next;
+	} else {
+		payload = block->bump;
+		block->bump += class_size(class);
+	}
+
+	++block->live;
+
+	if (!has_room(block))
+		unlink_block(class, block);
+
+	return payload;
+}
+
+void sq_arena_free(void *payload, size_t size) {
+	if (payload == NULL)
+		return;
+
+	if (SQ_ARENA_MAX_SIZE < size) {
+		free(payload);
+		return;
+	}
+
+	struct size_class *class = class_for(size);
+	struct block *block = block_of(payload);
+	struct free_payload *freed = payload;
+
+	sq_assert_eq(block->class, class, "payload freed with the wrong size");
+	sq_assert_nz(block->live);
+
+	if (!has_room(block))
+		link_block(class, block);
+
+	freed->next = block->free;
+	block->free = freed;
+
+	if (--block->live != 0)
+		return;
+
+	// Keep the last open block of a class around, so a class that keeps emptying and refilling
+	// a single block doesn't go back to `malloc` each time.
+	if (block->prev == NULL && block->next == NULL) {
+		block->free = NULL;
+		block->bump = (char *) block + HEADER_SIZE;
+		return;
+	}
+
+	unlink_block(class, block);
+	free(block);
+}
+
+void *sq_arena_realloc(void *payload, size_t size, size_t new_size, size_t length) {
+	sq_assert_le(length, new_size);
+
+	if (SQ_ARENA_MAX_SIZE < size && SQ_ARENA_MAX_SIZE < new_size)
+		return sq_realloc(payload, new_size);
+
+	// Payloads are rounded up to their class, so there's already room for `new_size` bytes.
+	if (payload != NULL && size <= SQ_ARENA_MAX_SIZE && new_size != 0
+		&& new_size <= SQ_ARENA_MAX_SIZE && class_for(size) == class_for(new_size))
+		return payload;
+
+	void *moved = sq_arena_malloc(new_size);
+
+	if (length)
+		memcpy(moved, payload, length);
+
+	sq_arena_free(payload, size);
+	return moved;
+}
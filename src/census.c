@@ -0,0 +1,240 @@
+#include <squire/census.h>
+#include <squire/gc.h>
+#include <squire/text.h>
+#include <squire/book.h>
+#include <squire/codex.h>
+#include <squire/form.h>
+#include <squire/journey.h>
+#include <squire/other/other.h>
+#include <squire/other/kingdom.h>
+#include <squire/shared.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+volatile sig_atomic_t sq_census_requested;
+static const char *census_prefix;
+static unsigned census_count;
+
+// How many values share a form or allocation site, and how many bytes they use.
+struct tally {
+	const char *name;
+	unsigned ip;
+	size_t values, bytes;
+};
+
+struct tallies {
+	struct tally *tallies;
+	size_t length, capacity;
+};
+
+struct census {
+	struct { size_t values, bytes; } genera[1 << SQ_GENUS_TAG_BITS];
+	struct tallies forms, sites;
+};
+
+// How many bytes `value` has allocated outside of the heap.
+static size_t external_size(sq_value value) {
+	switch (SQ_VTAG(value)) {
+	case SQ_G_TEXT:
+		return sq_value_as_text(value)->length;
+
+	case SQ_G_BOOK: {
+		struct sq_book *book = sq_value_as_book(value);
+		return sq_sizeof_array(sq_value, sq_book_front(book) + book->capacity);
+	}
+
+	case SQ_G_CODEX: {
+		struct sq_codex *codex = sq_value_as_codex(value);
+		size_t size = sq_sizeof_array(struct sq_codex_page, codex->capacity);
+
+		if (codex->buckets != NULL)
+			size += sq_sizeof_array(unsigned, codex->capacity * 2);
+
+		return size;
+	}
+
+	case SQ_G_IMITATION:
+		return sq_sizeof_array(sq_value, sq_value_as_imitation(value)->nmatter);
+
+	case SQ_G_FORM: {
+		const struct sq_form_vtable *vt = sq_value_as_form(value)->vt;
+
+		if (vt == NULL)
+			return 0;
+
+		return sizeof *vt
+			+ sq_sizeof_array(struct sq_essence, vt->nessences)
+			+ sq_sizeof_array(struct sq_form_matter, vt->nmatter)
+			+ sq_sizeof_array(struct sq_journey *, vt->nchanges + vt->nrecollections)
+			+ sq_sizeof_array(struct sq_form *, vt->nparents);
+	}
+
+	case SQ_G_JOURNEY: {
+		const struct sq_journey *journey = sq_value_as_journey(value);
+		size_t size = sq_sizeof_array(struct sq_journey_pattern, journey->npatterns);
+
+		for (unsigned i = 0; i < journey->npatterns; ++i) {
+			const struct sq_journey_pattern *pattern = &journey->patterns[i];
+
+			size += sq_sizeof_array(struct sq_journey_argument, pattern->pargc + pattern->kwargc)
+				+ sq_sizeof_array(union sq_bytecode, pattern->code.codelen)
+				+ sq_sizeof_array(sq_value, pattern->code.nconsts);
+
+			if (pattern->code.live != NULL)
+				size += sq_sizeof_array(struct sq_live_range, pattern->code.nlocals);
+		}
+
+		return size;
+	}
+
+	case SQ_G_OTHER: {
+		struct sq_other *other = sq_value_as_other(value);
+
+		if (other->kind == SQ_OK_KINGDOM)
+			return sq_sizeof_array(struct sq_kingdom_subject, other->kingdom.subject_cap);
+
+		return 0;
+	}
+
+	default:
+		return 0;
+	}
+}
+
+static void add_tally(struct tallies *tallies, const char *name, unsigned ip, size_t bytes) {
+	if (tallies->length == tallies->capacity) {
+		tallies->capacity = tallies->capacity ? tallies->capacity * 2 : 64;
+		tallies->tallies = sq_realloc_vec(struct tally, tallies->tallies, tallies->capacity);
+	}
+
+	tallies->tallies[tallies->length++] = (struct tally) {
+		.name = name, .ip = ip, .values = 1, .bytes = bytes
+	};
+}
+
+static void count_value(sq_value value, const struct sq_gc_site *site, void *data) {
+	struct census *census = data;
+	size_t bytes = external_size(value);
+
+	++census->genera[SQ_VTAG(value)].values;
+	census->genera[SQ_VTAG(value)].bytes += bytes;
+
+	if (sq_value_is_imitation(value))
+		add_tally(&census->forms, sq_value_as_imitation(value)->form->vt->name, 0, bytes);
+
+	if (site == NULL)
+		return;
+
+	if (site->journey == NULL)
+		add_tally(&census->sites, "<native>", 0, bytes);
+	else
+		add_tally(&census->sites, site->journey->name, site->ip, bytes);
+}
+
+static int compare_tallies(const void *l, const void *r) {
+	const struct tally *lhs = l, *rhs = r;
+	int cmp = strcmp(lhs->name, rhs->name);
+
+	if (cmp)
+		return cmp;
+
+	return lhs->ip < rhs->ip ? -1 : lhs->ip != rhs->ip;
+}
+
+// Sorts `tallies` and combines the ones with the same name and ip.
+static void merge_tallies(struct tallies *tallies) {
+	if (!tallies->length)
+		return;
+
+	qsort(tallies->tallies, tallies->length, sizeof *tallies->tallies, compare_tallies);
+
+	size_t merged = 0;
+	for (size_t i = 1; i < tallies->length; ++i) {
+		struct tally *last = &tallies->tallies[merged];
+
+		if (!compare_tallies(last, &tallies->tallies[i])) {
+			last->values += tallies->tallies[i].values;
+			last->bytes += tallies->tallies[i].bytes;
+		} else {
+			tallies->tallies[++merged] = tallies->tallies[i];
+		}
+	}
+
+	tallies->length = merged + 1;
+}
+
+void sq_census_write(FILE *out) {
+	struct census census = { 0 };
+	size_t values = 0, bytes = 0;
+
+	sq_gc_each_live(count_value, &census);
+	merge_tallies(&census.forms);
+	merge_tallies(&census.sites);
+
+	fprintf(out, "# kind\tname\tvalues\texternal_bytes\n");
+
+	for (unsigned i = 0; i < (1 << SQ_GENUS_TAG_BITS); ++i) {
+		if (!census.genera[i].values)
+			continue;
+
+		fprintf(out, "genus\t%s\t%zu\t%zu\n", sq_gc_genus_names[i],
+			census.genera[i].values, census.genera[i].bytes);
+		values += census.genera[i].values;
+		bytes += census.genera[i].bytes;
+	}
+
+	for (size_t i = 0; i < census.forms.length; ++i)
+		fprintf(out, "form\t%s\t%zu\t%zu\n", census.forms.tallies[i].name,
+			census.forms.tallies[i].values, census.forms.tallies[i].bytes);
+
+	for (size_t i = 0; i < census.sites.length; ++i)
+		fprintf(out, "site\t%s@%u\t%zu\t%zu\n", census.sites.tallies[i].name,
+			census.sites.tallies[i].ip, census.sites.tallies[i].values, census.sites.tallies[i].bytes);
+
+	fprintf(out, "total\t-\t%zu\t%zu\n", values, bytes);
+
+	free(census.forms.tallies);
+	free(census.sites.tallies);
+}
+
+static void request_census(int signal) {
+	(void) signal;
+	sq_census_requested = 1;
+}
+
+void sq_census_on_signal(const char *prefix) {
+	struct sigaction action = { .sa_handler = request_census };
+
+	census_prefix = prefix;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+
+	if (sigaction(SIGUSR1, &action, NULL))
+		sq_throw_io("unable to handle SIGUSR1");
+}
+
+void sq_census_take_requested(void) {
+	sq_census_requested = 0;
+
+	if (census_prefix == NULL) {
+		sq_census_write(stderr);
+		return;
+	}
+
+	// A census is only for diagnosing the program, so failing to write one doesn't stop it.
+	size_t length = strlen(census_prefix) + 16;
+	char *path = sq_malloc_vec(char, length);
+	snprintf(path, length, "%s.%u", census_prefix, ++census_count);
+
+	FILE *out = fopen(path, "w");
+
+	if (out == NULL) {
+		perror(path);
+	} else {
+		sq_census_write(out);
+		fclose(out);
+	}
+
+	free(path);
+}
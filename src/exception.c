@@ -17,6 +17,10 @@ unsigned current_exception_handler;
 // very basics of an exception with a form. todo: that
 struct sq_form sq_exception_form, sq_io_exception_form;
 struct sq_form_vtable sq_exception_form_vtable, sq_io_exception_form_vtable;
+static struct sq_journey exception_to_text = {
+	.basic = SQ_STATIC_BASIC(struct sq_journey),
+	.name = "to_text"
+};
 
 void sq_exception_init(struct sq_program *program) {
 	sq_exception_form.basic = SQ_STATIC_BASIC(struct sq_form);
@@ -30,7 +34,7 @@ void sq_exception_init(struct sq_program *program) {
 
 	sq_exception_form.vt->nchanges = 1;
 	sq_exception_form.vt->changes = sq_malloc_single(struct sq_journey *);
-	struct sq_journey *to_text = sq_exception_form.vt->changes[0] = sq_mallocv(struct sq_journey);
+	struct sq_journey *to_text = sq_exception_form.vt->changes[0] = &exception_to_text;
 
 	(void) to_text;
 	(void) program;
@@ -2,7 +2,22 @@
 #include <squire/basic.h>
 #include <squire/log.h>
 #include <squire/shared.h>
+#include <squire/exception.h>
+#include <squire/program.h>
+#include <squire/journey.h>
+#include <squire/codex.h>
+#include <squire/book.h>
+#include <squire/text.h>
+#include <squire/other/other.h>
 #include <sys/mman.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <time.h>
 
 struct anyvalue {
 	SQ_BASIC_DECLARATION basic;
@@ -11,77 +26,1397 @@ struct anyvalue {
 
 SQ_STATIC_ASSERT(sizeof(struct anyvalue) == SQ_VALUE_SIZE, "size isnt equal");
 
+#ifndef SQ_GC_MIN_MAJOR_THRESHOLD
+# define SQ_GC_MIN_MAJOR_THRESHOLD (16 * SQ_GC_NURSERY_SIZE)
+#endif /* !SQ_GC_MIN_MAJOR_THRESHOLD */
+
+#ifndef SQ_GC_CHUNK_SIZE
+# define SQ_GC_CHUNK_SIZE 65536 // how many values the heap grows and shrinks by at a time
+#endif /* !SQ_GC_CHUNK_SIZE */
+
+SQ_STATIC_ASSERT(SQ_GC_CHUNK_SIZE % 64 == 0, "chunks must fill whole bitmap words");
+
+#ifndef SQ_GC_HUGE_PAGE_SIZE
+# define SQ_GC_HUGE_PAGE_SIZE (2 << 20) // what the heap is aligned to when using huge pages
+#endif /* !SQ_GC_HUGE_PAGE_SIZE */
+
+#ifndef SQ_GC_SWEEP_BUDGET
+# define SQ_GC_SWEEP_BUDGET 16 // the default `sweep_budget`
+#endif /* !SQ_GC_SWEEP_BUDGET */
+
+#ifndef SQ_GC_PERMANENT_BLOCK
+# define SQ_GC_PERMANENT_BLOCK 4096 // how many values the permanent space grows by at a time
+#endif /* !SQ_GC_PERMANENT_BLOCK */
+
+#ifndef SQ_GC_PREFETCH_DISTANCE
+# define SQ_GC_PREFETCH_DISTANCE 8
+#endif /* !SQ_GC_PREFETCH_DISTANCE */
+
+#ifndef SQ_GC_MARK_THREADS
+# define SQ_GC_MARK_THREADS 1 // how many threads mark at once; above 1 requires `-pthread`
+#endif /* !SQ_GC_MARK_THREADS */
+
+#ifndef SQ_GC_MARK_BATCH
+# define SQ_GC_MARK_BATCH 256 // how many values marking threads share with one another at a time
+#endif /* !SQ_GC_MARK_BATCH */
+
+#if SQ_GC_MARK_THREADS > 1
+# include <pthread.h>
+#endif /* SQ_GC_MARK_THREADS > 1 */
+
+// A growable list of pointers, used for the nursery, the remembered set, and marked statics (among others).
+struct pointer_list {
+	void **ptrs;
+	size_t length, capacity;
+};
+
 static struct sq_program *program;
+static struct sq_gc_stats stats;
+
+struct sq_gc_config sq_gc_config = {
+	.initial_heap = SQ_GC_INITIAL_HEAP,
+	.maximum_heap = SQ_GC_MAXIMUM_HEAP,
+	.heap_growth = SQ_GC_HEAP_GROWTH,
+	.compact_threshold = SQ_GC_COMPACT_THRESHOLD,
+	.backing = SQ_GC_BACKING,
+	.sweep_budget = SQ_GC_SWEEP_BUDGET
+};
+
+/*
+ * Address space for the largest heap allowed is reserved up front, but only the first
+ * `committed` values of it are usable; the rest is committed a chunk at a time as the heap
+ * grows. As the heap is contiguous, a value's index (and whether a pointer is in the heap) is
+ * just arithmetic. Chunks which are emptied by a sweep are returned to the OS.
+ *
+ * `heap` is the high-water mark: no value at or above it has ever been allocated.
+ */
 static struct anyvalue *heap_start, *heap;
-static long long heap_size;
+static size_t committed, reserved;
+
+/*
+ * Which cells are allocated is kept in a side bitmap rather than in the cells themselves, so
+ * that finding a free cell is a `ctz` on the first word that isn't all ones, and sweeping the
+ * whole heap can skip 64 free cells at a time without touching them. `free_word` is a lower
+ * bound on the first word with a free bit in it.
+ */
+#define BITS_PER_WORD 64
+static uint64_t *allocated;
+
+/*
+ * Mark bits for values in the heap are kept in a bitmap alongside `allocated`, so that a
+ * collection only writes to the bitmap (and the values it frees) rather than to the header of
+ * every live value; this keeps a forked child's heap pages shared with its parent. Static
+ * values use the `marked` bit in their header instead.
+ */
+static uint64_t *marks;
+static size_t free_word;
+
+// Where each value in the heap was allocated, if `allocation_sites` is configured.
+static struct sq_gc_site *sites;
+
+/*
+ * Full collections don't free garbage themselves: the words of the bitmap from `sweep_word` up
+ * to `sweep_end` are swept by the allocator, `sweep_budget` at a time, whenever it
+ * catches up with them. Until then, old values which aren't marked in that range are garbage.
+ */
+static size_t sweep_word, sweep_end;
+
+static struct pointer_list nursery, remembered;
+
+/*
+ * Permanent values are bump allocated from blocks outside the heap, and are left marked for
+ * good, so marking stops at them without looking at their contents. Those which have been
+ * changed since they were allocated are in `mutated`, and are traced by every collection.
+ */
+static struct pointer_list permanent_blocks, mutated;
+static struct anyvalue *permanent_next, *permanent_end;
+static unsigned permanent_depth;
+static bool compaction_requested, deduplication_requested;
+static size_t pinned_holes; // how many free cells were left below `heap` by the last compaction
+static size_t traced, old_count, major_threshold = SQ_GC_MIN_MAJOR_THRESHOLD;
+static unsigned paused;
+static uintptr_t *stack_base;
+
+// Where the mutator's part of the stack ends, while a collection is running on its behalf.
+static uintptr_t *mutator_top;
+
+static void push_pointer(struct pointer_list *list, void *ptr) {
+	if (SQ_UNLIKELY(list->length == list->capacity)) {
+		list->capacity = list->capacity ? list->capacity * 2 : 256;
+		list->ptrs = sq_realloc_vec(void *, list->ptrs, list->capacity);
+	}
+
+	list->ptrs[list->length++] = ptr;
+}
+
+// Each thread that marks values has its own mark stack.
+struct marker {
+	struct pointer_list stack, statics;
+	struct sq_basic *tracing; // the value whose children are being marked
+	size_t traced;
+};
+
+static struct marker markers[SQ_GC_MARK_THREADS];
+
+#if SQ_GC_MARK_THREADS > 1
+static _Thread_local struct marker *marker = &markers[0];
+#else
+static struct marker *const marker = &markers[0];
+#endif /* SQ_GC_MARK_THREADS > 1 */
+
+static inline bool is_in_heap(const void *ptr) {
+	return (const void *) heap_start <= ptr && ptr < (const void *) heap;
+}
+
+static inline size_t index_of(const struct anyvalue *cell) {
+	return cell - heap_start;
+}
+
+static inline bool is_allocated(size_t index) {
+	return (allocated[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+}
+
+static inline bool is_marked_index(size_t index) {
+	return (marks[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+}
+
+static inline bool is_marked(const struct sq_basic *basic) {
+	if (SQ_LIKELY(is_in_heap(basic)))
+		return is_marked_index(index_of((const struct anyvalue *) basic));
+
+	return basic->marked;
+}
+
+static inline void unmark(struct sq_basic *basic) {
+	if (SQ_LIKELY(is_in_heap(basic))) {
+		size_t index = index_of((const struct anyvalue *) basic);
+		marks[index / BITS_PER_WORD] &= ~(1ULL << (index % BITS_PER_WORD));
+	} else {
+		basic->marked = 0;
+	}
+}
+
+static inline sq_value value_for(struct anyvalue *cell) {
+	return sq_value_new_ptr_unchecked((void *) cell, cell->basic.genus);
+}
+
+static bool parse_size(const char *value, size_t *size) {
+	char *end;
+	unsigned shift = 0;
+
+	errno = 0;
+	unsigned long long number = strtoull(value, &end, 10);
+
+	if (end == value || errno)
+		return false;
+
+	switch (tolower((unsigned char) *end)) {
+	case '\0': break;
+	case 'k': shift = 10; break;
+	case 'm': shift = 20; break;
+	case 'g': shift = 30; break;
+	default: return false;
+	}
+
+	if ((shift && end[1] != '\0') || (SIZE_MAX >> shift) < number)
+		return false;
+
+	*size = (size_t) number << shift;
+	return true;
+}
 
-void sq_gc_init(long long heap_size_, struct sq_program *program_) {
-	heap_size = heap_size_ * SQ_VALUE_SIZE;
+static bool parse_bool(const char *value, bool *flag) {
+	if (strcmp(value, "0") && strcmp(value, "1"))
+		return false;
 
+	*flag = *value == '1';
+	return true;
+}
+
+static bool parse_backing(const char *value, unsigned *backing) {
+	if (!strcmp(value, "default")) {
+		*backing = 0;
+		return true;
+	}
+
+	unsigned flags = 0;
+
+	for (const char *end; *value; value = *end ? end + 1 : end) {
+		end = strchr(value, ',');
+		if (end == NULL)
+			end = value + strlen(value);
+
+		if (end - value == 4 && !strncmp(value, "huge", 4))
+			flags |= SQ_GC_HUGE_PAGES;
+		else if (end - value == 8 && !strncmp(value, "prefault", 8))
+			flags |= SQ_GC_PREFAULT;
+		else
+			return false;
+	}
+
+	*backing = flags;
+	return true;
+}
+
+bool sq_gc_configure(const char *name, const char *value) {
+	if (!strcmp(name, "heap-initial"))
+		return parse_size(value, &sq_gc_config.initial_heap);
+
+	if (!strcmp(name, "heap-max"))
+		return parse_size(value, &sq_gc_config.maximum_heap);
+
+	if (!strcmp(name, "heap-growth")) {
+		char *end;
+		double growth = strtod(value, &end);
+
+		if (end == value || *end != '\0' || !(1.0 < growth))
+			return false;
+
+		sq_gc_config.heap_growth = growth;
+		return true;
+	}
+
+	if (!strcmp(name, "compact-threshold")) {
+		char *end;
+		unsigned long percent = strtoul(value, &end, 10);
+
+		if (!isdigit(*value) || *end != '\0' || 100 < percent)
+			return false;
+
+		sq_gc_config.compact_threshold = percent;
+		return true;
+	}
+
+	if (!strcmp(name, "allocation-sites"))
+		return parse_bool(value, &sq_gc_config.allocation_sites);
+
+	if (!strcmp(name, "dedup-texts"))
+		return parse_bool(value, &sq_gc_config.deduplicate_texts);
+
+	if (!strcmp(name, "heap-backing"))
+		return parse_backing(value, &sq_gc_config.backing);
+
+	if (!strcmp(name, "sweep-budget")) {
+		char *end;
+		unsigned long long words = strtoull(value, &end, 10);
+
+		if (!isdigit(*value) || *end != '\0' || !words)
+			return false;
+
+		sq_gc_config.sweep_budget = words;
+		return true;
+	}
+
+	return false;
+}
+
+static size_t round_to_chunks(size_t values) {
+	return (values + SQ_GC_CHUNK_SIZE - 1) / SQ_GC_CHUNK_SIZE * SQ_GC_CHUNK_SIZE;
+}
+
+static void *reserve(size_t bytes) {
+	void *start = mmap(NULL, bytes, PROT_NONE, MAP_ANON|MAP_PRIVATE|MAP_NORESERVE, -1, 0);
+
+	if (start == MAP_FAILED)
+		sq_throw_io("unable to reserve %zu bytes for the heap", bytes);
+
+	return start;
+}
+
+/*
+ * Huge pages only back whole, aligned, huge pages, so the heap is aligned to them. Chunks are
+ * the size of one by default, so emptied ones are still given back whole.
+ */
+static void *reserve_huge(size_t bytes) {
+	char *start = reserve(bytes + SQ_GC_HUGE_PAGE_SIZE);
+	char *aligned = (char *) (((uintptr_t) start + SQ_GC_HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (SQ_GC_HUGE_PAGE_SIZE - 1));
+
+	if (start != aligned)
+		munmap(start, aligned - start);
+	munmap(aligned + bytes, start + SQ_GC_HUGE_PAGE_SIZE - aligned);
+
+	// This is only a hint, so it's fine if the kernel can't take it.
+	if (madvise(aligned, bytes, MADV_HUGEPAGE)) {
+		sq_log(gc, 1, "unable to use huge pages for the heap");
+	}
+
+	return aligned;
+}
+
+static void commit(void *start, size_t bytes) {
+	if (mprotect(start, bytes, PROT_READ|PROT_WRITE))
+		sq_throw_io("unable to commit %zu bytes for the heap", bytes);
+}
+
+// Faults in the newly committed `bytes` at `start`, if the heap's configured to.
+static void prefault(void *start, size_t bytes) {
+	if (!(sq_gc_config.backing & SQ_GC_PREFAULT))
+		return;
+
+#ifdef MADV_POPULATE_WRITE
+	if (!madvise(start, bytes, MADV_POPULATE_WRITE))
+		return;
+#endif /* MADV_POPULATE_WRITE */
+
+	// Older kernels don't have `MADV_POPULATE_WRITE`, so each page is written to instead.
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	for (size_t offset = 0; offset < bytes; offset += page_size)
+		((volatile char *) start)[offset] = 0;
+}
+
+static bool grow_heap(void) {
+	if (committed == reserved)
+		return false;
+
+	size_t values = round_to_chunks((size_t) (committed * sq_gc_config.heap_growth));
+
+	if (values <= committed)
+		values = committed + SQ_GC_CHUNK_SIZE;
+
+	if (reserved < values)
+		values = reserved;
+
+	commit(heap_start, values * SQ_VALUE_SIZE);
+	prefault(heap_start + committed, (values - committed) * SQ_VALUE_SIZE);
+	commit(allocated, values / BITS_PER_WORD * sizeof *allocated);
+	commit(marks, values / BITS_PER_WORD * sizeof *marks);
+	if (sites != NULL)
+		commit(sites, values * sizeof *sites);
+
+	sq_log(gc, 1, "grew the heap from %zu to %zu values", committed, values);
+	committed = values;
+	return true;
+}
+
+static void release_chunk_if_empty(size_t chunk) {
+	const uint64_t *words = &allocated[chunk * (SQ_GC_CHUNK_SIZE / BITS_PER_WORD)];
+
+	for (size_t i = 0; i < SQ_GC_CHUNK_SIZE / BITS_PER_WORD; ++i)
+		if (words[i])
+			return;
+
+	// The pages are zero again the next time they're used.
+	madvise(&heap_start[chunk * SQ_GC_CHUNK_SIZE], SQ_GC_CHUNK_SIZE * SQ_VALUE_SIZE, MADV_DONTNEED);
+}
+
+void sq_gc_init(struct sq_program *program_) {
 	program = program_;
-	heap_start = heap = mmap(NULL, heap_size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE, 0, 0);
 
-	if (heap == MAP_FAILED)
-		sq_throw_io("unable to mmap %zu bytes for the heap", heap_size);
+	reserved = round_to_chunks(sq_gc_config.maximum_heap / SQ_VALUE_SIZE);
+	if (reserved == 0)
+		reserved = SQ_GC_CHUNK_SIZE;
+
+	heap_start = heap = sq_gc_config.backing & SQ_GC_HUGE_PAGES
+		? reserve_huge(reserved * SQ_VALUE_SIZE)
+		: reserve(reserved * SQ_VALUE_SIZE);
+	allocated = reserve(reserved / BITS_PER_WORD * sizeof *allocated);
+	marks = reserve(reserved / BITS_PER_WORD * sizeof *marks);
+
+	committed = round_to_chunks(sq_gc_config.initial_heap / SQ_VALUE_SIZE);
+	if (committed == 0)
+		committed = SQ_GC_CHUNK_SIZE;
+	if (reserved < committed)
+		committed = reserved;
 
-	sq_log(gc, 1, "initialized gc heap with %lld (0x%llx) bytes of memory", heap_size, heap_size);
+	commit(heap_start, committed * SQ_VALUE_SIZE);
+	prefault(heap_start, committed * SQ_VALUE_SIZE);
+	commit(allocated, committed / BITS_PER_WORD * sizeof *allocated);
+	commit(marks, committed / BITS_PER_WORD * sizeof *marks);
+
+	if (sq_gc_config.allocation_sites) {
+		sites = reserve(reserved * sizeof *sites);
+		commit(sites, committed * sizeof *sites);
+	}
+
+	// This is called from `main`, so every frame that could reference a value is below us.
+	stack_base = __builtin_frame_address(0);
+
+	nursery.capacity = SQ_GC_NURSERY_SIZE;
+	nursery.ptrs = sq_malloc_vec(void *, nursery.capacity);
+
+	sq_log(gc, 1, "initialized gc heap with %zu values, growing up to %zu (backing %u)",
+		committed, reserved, sq_gc_config.backing);
 }
 
 void sq_gc_teardown(void) {
-	if (munmap(heap_start, heap_size))
-		sq_throw_io("unable to un mmap %zu bytes for the heap", heap_size);
+	if (munmap(heap_start, reserved * SQ_VALUE_SIZE))
+		sq_throw_io("unable to un mmap %zu bytes for the heap", reserved * SQ_VALUE_SIZE);
+
+	if (munmap(allocated, reserved / BITS_PER_WORD * sizeof *allocated))
+		sq_throw_io("unable to un mmap the allocation bitmap");
+
+	if (munmap(marks, reserved / BITS_PER_WORD * sizeof *marks))
+		sq_throw_io("unable to un mmap the mark bitmap");
+
+	if (sites != NULL && munmap(sites, reserved * sizeof *sites))
+		sq_throw_io("unable to un mmap the allocation sites");
+
+	free(nursery.ptrs);
+	free(remembered.ptrs);
+	free(mutated.ptrs);
+
+	for (size_t i = 0; i < permanent_blocks.length; ++i)
+		free(permanent_blocks.ptrs[i]);
+	free(permanent_blocks.ptrs);
+
+	// Marking threads are left parked until the process exits, and keep their stacks.
+	if (SQ_GC_MARK_THREADS == 1) {
+		free(markers[0].stack.ptrs);
+		free(markers[0].statics.ptrs);
+	}
 }
 
-void *sq_gc_malloc(enum sq_genus_tag genus) {
-	if (SQ_UNLIKELY((heap_size / SQ_VALUE_SIZE) <= (heap - heap_start))) {
-		sq_gc_start();
+void sq_gc_pause(void) {
+	++paused;
+}
+
+void sq_gc_resume(void) {
+	sq_assert_nz(paused);
+	--paused;
+}
+
+void sq_gc_begin_permanent(void) {
+	++permanent_depth;
+}
+
+void sq_gc_end_permanent(void) {
+	sq_assert_nz(permanent_depth);
+	--permanent_depth;
+}
 
-		if (SQ_UNLIKELY((heap_size / SQ_VALUE_SIZE) <= heap - heap_start))
-			sq_throw("heap exhausted.");
+static void *allocate_permanent(enum sq_genus_tag genus) {
+	if (SQ_UNLIKELY(permanent_next == permanent_end)) {
+		permanent_next = sq_malloc_vec(struct anyvalue, SQ_GC_PERMANENT_BLOCK);
+		permanent_end = permanent_next + SQ_GC_PERMANENT_BLOCK;
+		push_pointer(&permanent_blocks, permanent_next);
 	}
 
-	while (heap->basic.in_use) {
-		sq_log(gc, 2, "skipping in-use address %p", (void *) heap);
-		++heap;
+	struct anyvalue *cell = permanent_next++;
+	++stats.permanent;
+
+	memset(cell, 0, sizeof *cell);
+	cell->basic.genus = genus;
+	cell->basic.in_use = 1;
+	cell->basic.old = 1;
+	cell->basic.marked = 1;
+	cell->basic.permanent = 1;
+
+	sq_log(gc, 2, "allocated permanent value at address %p", (void *) cell);
+	return cell;
+}
+
+bool sq_gc_mark(struct sq_basic *basic) {
+	if (basic == marker->tracing) {
+		marker->tracing = NULL;
+		return false;
 	}
-	heap->basic.genus = genus;
-	heap->basic.in_use = 1;
-	sq_log(gc, 2, "found unused heap at address %p", (void *) heap);
-	return heap++;
+
+	if (!is_marked(basic))
+		push_pointer(&marker->stack, basic);
+
+	return true;
 }
 
-void sq_gc_start(void) {
-#if SQ_LOG_GC >= 1
-#define INCR_METRIC(name) do { name++; } while(0);
-	long unsigned unused = 0, marked = 0, freed = 0;
-	sq_log(gc, 1, "starting gc cycle");
+// Sets `basic`'s mark bit, returning whether it wasn't already set.
+static inline bool try_mark(struct sq_basic *basic) {
+	if (SQ_LIKELY(is_in_heap(basic))) {
+		size_t index = index_of((const struct anyvalue *) basic);
+		uint64_t bit = 1ULL << (index % BITS_PER_WORD);
+
+#if SQ_GC_MARK_THREADS > 1
+		// Other threads may be marking the same value, so the bit has to be set atomically.
+		return !(__atomic_fetch_or(&marks[index / BITS_PER_WORD], bit, __ATOMIC_RELAXED) & bit);
 #else
-#define INCR_METRIC(name) do { } while(0)
+		if (marks[index / BITS_PER_WORD] & bit)
+			return false;
+
+		marks[index / BITS_PER_WORD] |= bit;
+		return true;
+#endif /* SQ_GC_MARK_THREADS > 1 */
+	}
+
+#if SQ_GC_MARK_THREADS > 1
+	// As the header's `marked` is a bitfield, the entire header is swapped.
+	struct sq_basic expected, desired;
+	__atomic_load(basic, &expected, __ATOMIC_RELAXED);
+
+	do {
+		if (expected.marked)
+			return false;
+
+		desired = expected;
+		desired.marked = 1;
+	} while (!__atomic_compare_exchange(basic, &expected, &desired, true,
+		__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return true;
+#else
+	if (basic->marked)
+		return false;
+
+	basic->marked = 1;
+	return true;
+#endif /* SQ_GC_MARK_THREADS > 1 */
+}
+
+#if SQ_GC_MARK_THREADS > 1
+/*
+ * Threads share work through a pool of values waiting to be traced: whenever a thread has
+ * plenty of values on its stack and the pool is empty, it donates half of them; a thread
+ * that runs out takes a batch from the pool. Marking is finished once every thread is
+ * waiting on an empty pool.
+ *
+ * The other threads are only woken up once the main thread first has enough work to share,
+ * so small collections are marked by the main thread alone.
+ */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t start, wakeup, finished;
+	struct pointer_list work;
+	unsigned long generation;
+	unsigned idle, running;
+	bool active, started;
+} pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.start = PTHREAD_COND_INITIALIZER,
+	.wakeup = PTHREAD_COND_INITIALIZER,
+	.finished = PTHREAD_COND_INITIALIZER,
+};
+
+static void trace(struct marker *);
+static void *mark_thread(void *);
+
+// Must be called with `pool.lock` held.
+static void start_mark_threads(void) {
+	if (!pool.started) {
+		pool.started = true;
+
+		for (unsigned i = 1; i < SQ_GC_MARK_THREADS; ++i) {
+			pthread_t thread;
+
+			if (pthread_create(&thread, NULL, mark_thread, &markers[i]) || pthread_detach(thread))
+				sq_throw_io("unable to start a marking thread");
+		}
+	}
+
+	pool.active = true;
+	pool.idle = 0;
+	pool.running = SQ_GC_MARK_THREADS - 1;
+	++pool.generation;
+	pthread_cond_broadcast(&pool.start);
+}
+
+static void share_work(struct marker *m) {
+	pthread_mutex_lock(&pool.lock);
+
+	for (size_t half = m->stack.length / 2; half; --half)
+		push_pointer(&pool.work, m->stack.ptrs[--m->stack.length]);
+
+	if (!pool.active)
+		start_mark_threads();
+	else
+		pthread_cond_broadcast(&pool.wakeup);
+
+	pthread_mutex_unlock(&pool.lock);
+}
+
+// Returns false once every thread has run out of work.
+static bool take_work(struct marker *m) {
+	pthread_mutex_lock(&pool.lock);
+	++pool.idle;
+
+	while (pool.work.length == 0 && pool.idle < SQ_GC_MARK_THREADS)
+		pthread_cond_wait(&pool.wakeup, &pool.lock);
+
+	bool found = pool.work.length != 0;
+
+	if (found) {
+		--pool.idle;
+
+		for (size_t i = 0; i < SQ_GC_MARK_BATCH && pool.work.length; ++i)
+			push_pointer(&m->stack, pool.work.ptrs[--pool.work.length]);
+	} else {
+		pthread_cond_broadcast(&pool.wakeup);
+	}
+
+	pthread_mutex_unlock(&pool.lock);
+	return found;
+}
+
+static void *mark_thread(void *arg) {
+	unsigned long seen = 0;
+	marker = arg;
+
+	while (true) {
+		pthread_mutex_lock(&pool.lock);
+
+		while (pool.generation == seen)
+			pthread_cond_wait(&pool.start, &pool.lock);
+
+		seen = pool.generation;
+		pthread_mutex_unlock(&pool.lock);
+
+		while (take_work(marker))
+			trace(marker);
+
+		pthread_mutex_lock(&pool.lock);
+
+		if (--pool.running == 0)
+			pthread_cond_signal(&pool.finished);
+
+		pthread_mutex_unlock(&pool.lock);
+	}
+}
+#endif /* SQ_GC_MARK_THREADS > 1 */
+
+static void trace(struct marker *m) {
+	while (m->stack.length) {
+		struct sq_basic *basic = m->stack.ptrs[--m->stack.length];
+
+		// Values that were pushed long ago may have left the cache, so fetch the ones we'll be
+		// tracing soon while we trace this one.
+		if (SQ_GC_PREFETCH_DISTANCE <= m->stack.length)
+			SQ_PREFETCH(m->stack.ptrs[m->stack.length - SQ_GC_PREFETCH_DISTANCE]);
+
+		// values can be pushed more than once before they're popped.
+		if (!try_mark(basic))
+			continue;
+
+		// Values outside the heap are static, and never swept; their marks are reset after each
+		// collection so that they're traced again the next time they're reached. Permanent ones
+		// stay marked.
+		if (SQ_UNLIKELY(!is_in_heap(basic))) {
+			if (!basic->permanent)
+				push_pointer(&m->statics, basic);
+		}
+		else
+			++m->traced;
+
+#if SQ_GC_MARK_THREADS > 1
+		if (SQ_UNLIKELY(2 * SQ_GC_MARK_BATCH <= m->stack.length)
+			&& __atomic_load_n(&pool.work.length, __ATOMIC_RELAXED) == 0)
+			share_work(m);
+#endif /* SQ_GC_MARK_THREADS > 1 */
+
+		m->tracing = basic;
+		sq_value_mark(sq_value_new_ptr_unchecked((void *) basic, basic->genus));
+		m->tracing = NULL;
+	}
+}
+
+static void drain_mark_stack(void) {
+	trace(&markers[0]);
+
+#if SQ_GC_MARK_THREADS > 1
+	if (pool.active) {
+		while (take_work(&markers[0]))
+			trace(&markers[0]);
+
+		pthread_mutex_lock(&pool.lock);
+
+		while (pool.running)
+			pthread_cond_wait(&pool.finished, &pool.lock);
+
+		pool.active = false;
+		pthread_mutex_unlock(&pool.lock);
+	}
+#endif /* SQ_GC_MARK_THREADS > 1 */
+
+	for (unsigned i = 0; i < SQ_GC_MARK_THREADS; ++i) {
+		traced += markers[i].traced;
+		markers[i].traced = 0;
+	}
+}
+
+void sq_gc_remember(struct sq_basic *parent) {
+	parent->remembered = 1;
+	push_pointer(parent->permanent ? &mutated : &remembered, parent);
+}
+
+static void free_cell(struct anyvalue *cell) {
+	sq_value_deallocate(value_for(cell));
+	cell->basic.in_use = 0;
+	--stats.live;
+
+	size_t index = index_of(cell);
+	allocated[index / BITS_PER_WORD] &= ~(1ULL << (index % BITS_PER_WORD));
+
+	if (index / BITS_PER_WORD < free_word)
+		free_word = index / BITS_PER_WORD;
+}
+
+static inline bool is_garbage(size_t index) {
+	return sweep_word <= index / BITS_PER_WORD && index / BITS_PER_WORD < sweep_end
+		&& !is_marked_index(index) && heap_start[index].basic.old;
+}
+
+static void mark_word(uintptr_t word) {
+	if (!is_in_heap((void *) word))
+		return;
+
+	// Tagged values and pointers into the middle of a value both refer to the value they're in.
+	size_t index = (word - (uintptr_t) heap_start) / SQ_VALUE_SIZE;
+
+	// Garbage that's yet to be swept may reference values that have already been freed.
+	if (is_allocated(index) && !is_garbage(index))
+		sq_value_mark(value_for(heap_start + index));
+}
+
+SQ_NOINLINE SQ_NO_SANITIZE_ADDRESS
+static void scan_c_stack_from(uintptr_t *top, void (*visit)(uintptr_t)) {
+	for (uintptr_t *word = top; word < stack_base; ++word)
+		visit(*word);
+}
+
+static void mark_c_stack(void) {
+	// The collector's own frames are skipped: whatever they haven't written yet is just stale
+	// words from earlier, deeper calls, which could otherwise keep dead values alive.
+	if (mutator_top != NULL) {
+		scan_c_stack_from(mutator_top, mark_word);
+		return;
+	}
+
+	// Spill every callee-saved register onto the stack, so they're scanned too.
+	jmp_buf registers;
+	setjmp(registers);
+#if SQ_HAS_BUILTIN(__builtin_unwind_init)
+	__builtin_unwind_init();
 #endif
 
+	scan_c_stack_from((uintptr_t *) &registers, mark_word);
+}
+
+static void mark_roots(void) {
 	sq_program_mark(program);
 
-	for (struct anyvalue *ptr = heap_start; ptr < heap; ++ptr) {
-		if (!ptr->basic.in_use) {
-			sq_log(gc, 2, "ptr %p is in unused", heap);
-			INCR_METRIC(unused);
+	if (sq_current_exception != SQ_NI)
+		sq_value_mark(sq_current_exception);
+
+	for (size_t i = 0; i < mutated.length; ++i) {
+		struct sq_basic *parent = mutated.ptrs[i];
+
+		parent->marked = 0;
+		sq_value_mark(sq_value_new_ptr_unchecked((void *) parent, parent->genus));
+	}
+
+	mark_c_stack();
+	drain_mark_stack();
+}
+
+static void unmark_statics(void) {
+	for (unsigned i = 0; i < SQ_GC_MARK_THREADS; ++i) {
+		struct pointer_list *statics = &markers[i].statics;
+
+		for (size_t j = 0; j < statics->length; ++j)
+			((struct sq_basic *) statics->ptrs[j])->marked = 0;
+
+		statics->length = 0;
+	}
+}
+
+static void forget_remembered(void) {
+	for (size_t i = 0; i < remembered.length; ++i)
+		((struct sq_basic *) remembered.ptrs[i])->remembered = 0;
+
+	remembered.length = 0;
+}
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// The heap's as full as it gets right before values are freed, so this is called before each
+// collection.
+static void update_peaks(void) {
+	if (stats.peak_live < stats.live)
+		stats.peak_live = stats.live;
+}
+
+static void record_pause(uint64_t start) {
+	uint64_t pause = now() - start;
+	unsigned bucket = 0;
+
+	for (uint64_t limit = 100000; bucket + 1 < SQ_GC_PAUSE_BUCKETS && limit <= pause; limit *= 10)
+		++bucket;
+
+	++stats.pauses[bucket];
+	stats.total_pause += pause;
+
+	if (stats.longest_pause < pause)
+		stats.longest_pause = pause;
+}
+
+/*
+ * Only values in the nursery are swept. Old values are left marked between collections, so
+ * marking stops as soon as it reaches one; the only old values that are traced are those
+ * which have been remembered by `sq_gc_write_barrier`, as they may reference young values.
+ */
+static void collect_nursery(void) {
+	size_t promoted = 0, freed = 0;
+	uint64_t start = now();
+	update_peaks();
+	sq_log(gc, 1, "starting nursery collection (%zu values, %zu remembered)",
+		nursery.length, remembered.length);
+
+	mark_roots();
+
+	for (size_t i = 0; i < remembered.length; ++i) {
+		struct sq_basic *parent = remembered.ptrs[i];
+
+		unmark(parent);
+		sq_value_mark(sq_value_new_ptr_unchecked((void *) parent, parent->genus));
+	}
+
+	drain_mark_stack();
+
+	forget_remembered();
+
+	for (size_t i = 0; i < nursery.length; ++i) {
+		struct anyvalue *cell = nursery.ptrs[i];
+
+		if (is_marked_index(index_of(cell))) {
+			cell->basic.old = 1;
+			++promoted;
+		} else {
+			free_cell(cell);
+			++freed;
+		}
+	}
+
+	nursery.length = 0;
+	old_count += promoted;
+	unmark_statics();
+
+	++stats.nursery_collections;
+	record_pause(start);
+
+	sq_log(gc, 1, "nursery collection finished: %zu promoted, %zu freed", promoted, freed);
+	(void) freed;
+}
+
+static void sweep_some(void) {
+	size_t end = sweep_end;
+
+	if (sq_gc_config.sweep_budget < sweep_end - sweep_word)
+		end = sweep_word + sq_gc_config.sweep_budget;
+
+	for (; sweep_word < end; ++sweep_word) {
+		uint64_t unmarked = allocated[sweep_word] & ~marks[sweep_word];
+
+		for (; unmarked; unmarked &= unmarked - 1) {
+			struct anyvalue *cell = &heap_start[sweep_word * BITS_PER_WORD + __builtin_ctzll(unmarked)];
+
+			// Young values allocated since the marks were set aren't garbage.
+			if (cell->basic.old)
+				free_cell(cell);
+		}
+
+		if ((sweep_word + 1) % (SQ_GC_CHUNK_SIZE / BITS_PER_WORD) == 0)
+			release_chunk_if_empty(sweep_word / (SQ_GC_CHUNK_SIZE / BITS_PER_WORD));
+	}
+}
+
+/*
+ * Only the nursery is swept eagerly, so that every value left unmarked afterwards is old; the
+ * rest of the heap is swept lazily by the allocator.
+ */
+static void collect_everything(void) {
+	size_t freed = 0;
+	uint64_t start = now();
+	update_peaks();
+	sq_log(gc, 1, "starting full collection (%zu words left unswept)", sweep_end - sweep_word);
+
+	size_t words = (index_of(heap) + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+	// Garbage from the last collection that's yet to be swept must be freed before the marks
+	// are reset, as it'd otherwise look the same as live values.
+	while (sweep_word < sweep_end)
+		sweep_some();
+
+	memset(marks, 0, words * sizeof *marks);
+	sweep_word = sweep_end = 0;
+	traced = 0;
+
+	forget_remembered();
+	mark_roots();
+
+	for (size_t i = 0; i < nursery.length; ++i) {
+		struct anyvalue *cell = nursery.ptrs[i];
+
+		if (is_marked_index(index_of(cell))) {
+			cell->basic.old = 1;
+		} else {
+			free_cell(cell);
+			++freed;
+		}
+	}
+
+	nursery.length = 0;
+	unmark_statics();
+
+	sweep_end = words;
+	old_count = traced;
+	major_threshold = 2 * traced < SQ_GC_MIN_MAJOR_THRESHOLD ? SQ_GC_MIN_MAJOR_THRESHOLD : 2 * traced;
+
+	// Values can't be moved from here, as C code may be holding them where they aren't
+	// scanned; instead, the interpreter compacts the next time it's safe to. It's only worth it
+	// if at least a chunk more than pinned values left behind last time could be given back.
+	size_t used = index_of(heap), holes = used - traced;
+	if (sq_gc_config.compact_threshold && pinned_holes + SQ_GC_CHUNK_SIZE <= holes
+		&& used * sq_gc_config.compact_threshold <= holes * 100)
+		compaction_requested = true;
+
+	// Likewise, C code may be using a text's contents, so they can't be freed here.
+	if (sq_gc_config.deduplicate_texts)
+		deduplication_requested = true;
+
+	sq_gc_safepoint_pending = compaction_requested || deduplication_requested;
+
+	++stats.full_collections;
+	record_pause(start);
+
+	sq_log(gc, 1, "full collection finished: %zu marked, %zu young values freed", traced, freed);
+	(void) freed;
+}
+
+void sq_gc_start(void) {
+	collect_everything();
+}
+
+bool sq_gc_safepoint_pending;
+
+/*
+ * Compaction slides every live value down into the lowest free cell, keeping their order.
+ * `forwards[i]` is where the value at index `i` goes; pinned values stay where they are, and
+ * others slide around them.
+ */
+static uint64_t *pins;
+static uint32_t *forwards;
+
+static inline bool is_pinned(size_t index) {
+	return (pins[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+}
+
+static void pin_word(uintptr_t word) {
+	if (!is_in_heap((void *) word))
+		return;
+
+	size_t index = (word - (uintptr_t) heap_start) / SQ_VALUE_SIZE;
+
+	if (is_allocated(index))
+		pins[index / BITS_PER_WORD] |= 1ULL << (index % BITS_PER_WORD);
+}
+
+SQ_NOINLINE
+static void pin_c_stack(void) {
+	jmp_buf registers;
+	setjmp(registers);
+#if SQ_HAS_BUILTIN(__builtin_unwind_init)
+	__builtin_unwind_init();
+#endif
+
+	scan_c_stack_from((uintptr_t *) &registers, pin_word);
+}
+
+// Pins everything that `key`'s hash depends on the address of (see `sq_value_hash`).
+static void pin_hashed(sq_value key) {
+	switch (SQ_VTAG(key)) {
+	case SQ_G_NUMERAL:
+	case SQ_G_TEXT:
+		return;
+
+	case SQ_G_BOOK:
+		for (unsigned i = 0; i < sq_value_as_book(key)->length; ++i)
+			pin_hashed(sq_value_as_book(key)->pages[i]);
+		return;
+
+	case SQ_G_CODEX:
+		for (unsigned i = 0; i < sq_value_as_codex(key)->length; ++i)
+			pin_hashed(sq_value_as_codex(key)->pages[i].value);
+		return;
+
+	default:
+		if (SQ_UNDEFINED < key)
+			pin_word(SQ_VUNMASK(key));
+	}
+}
+
+// Returns false if `basic` can't be compacted around.
+static bool pin_referenced(struct sq_basic *basic) {
+	if (basic->genus == SQ_G_CODEX) {
+		struct sq_codex *codex = (struct sq_codex *) basic;
+
+		for (unsigned i = 0; i < codex->length; ++i)
+			pin_hashed(codex->pages[i].key);
+	}
+
+	// Externals' data may reference values, and only the code that made them knows where.
+	return basic->genus != SQ_G_OTHER || ((struct sq_other *) basic)->kind != SQ_OK_EXTERNAL;
+}
+
+void *sq_gc_relocated(void *ptr) {
+	if (!is_in_heap(ptr))
+		return ptr;
+
+	return &heap_start[forwards[index_of(ptr)]];
+}
+
+void sq_gc_relocate(sq_value *value) {
+	if (sq_value_is_numeral(*value) || *value <= SQ_UNDEFINED)
+		return;
+
+	*value = sq_value_new_ptr_unchecked(sq_gc_relocated((void *) SQ_VUNMASK(*value)), SQ_VTAG(*value));
+}
+
+// The first allocated index at or after `index`, or `SIZE_MAX` if there aren't any.
+static size_t next_live(size_t index, size_t words) {
+	for (size_t word = index / BITS_PER_WORD; word < words; ++word) {
+		uint64_t bits = allocated[word];
+
+		if (word == index / BITS_PER_WORD)
+			bits &= ~0ULL << (index % BITS_PER_WORD);
+
+		if (bits)
+			return word * BITS_PER_WORD + __builtin_ctzll(bits);
+	}
+
+	return SIZE_MAX;
+}
+
+#define EACH_LIVE(index, words) \
+	for (size_t index = next_live(0, words); index != SIZE_MAX; index = next_live(index + 1, words))
+
+// Moves every live value to `forwards[index]`, rebuilding both bitmaps; returns how many moved.
+static size_t slide(size_t words) {
+	size_t moved = 0;
+
+	// The marks are a copy of `allocated` after a full sweep, so they're what's iterated.
+	memset(allocated, 0, words * sizeof *allocated);
+	heap = heap_start;
+
+	for (size_t word = 0; word < words; ++word) {
+		for (uint64_t bits = marks[word]; bits; bits &= bits - 1) {
+			size_t from = word * BITS_PER_WORD + __builtin_ctzll(bits), to = forwards[from];
+
+			if (to != from) {
+				memcpy(&heap_start[to], &heap_start[from], sizeof *heap_start);
+				if (sites != NULL)
+					sites[to] = sites[from];
+				++moved;
+			}
+
+			allocated[to / BITS_PER_WORD] |= 1ULL << (to % BITS_PER_WORD);
+
+			// Values can slide below pinned ones before them, so this isn't always the last.
+			if (heap <= &heap_start[to])
+				heap = &heap_start[to + 1];
+		}
+	}
+
+	memcpy(marks, allocated, words * sizeof *marks);
+	return moved;
+}
+
+void sq_gc_compact(void) {
+	compaction_requested = false;
+
+	if (paused)
+		return;
+
+	collect_everything();
+	compaction_requested = false;
+	while (sweep_word < sweep_end)
+		sweep_some();
+
+	uint64_t start = now();
+	size_t used = index_of(heap), words = (used + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+	if (UINT32_MAX < used)
+		return;
+
+	pins = sq_calloc(words, sizeof *pins);
+	pin_c_stack();
+
+	bool movable = true;
+	for (size_t i = 0; i < mutated.length; ++i)
+		movable &= pin_referenced(mutated.ptrs[i]);
+	EACH_LIVE(index, words)
+		movable &= pin_referenced(&heap_start[index].basic);
+
+	if (!movable) {
+		sq_log(gc, 1, "not compacting, as there are externals in the heap");
+		pinned_holes = used - traced;
+		free(pins);
+		return;
+	}
+
+	forwards = sq_malloc_vec(uint32_t, used);
+
+	size_t next = 0;
+	EACH_LIVE(index, words) {
+		if (is_pinned(index)) {
+			forwards[index] = index;
 			continue;
 		}
 
-		if (ptr->basic.marked) {
-			sq_log(gc, 2, "ptr %p is in marked", heap);
-			INCR_METRIC(marked);
-			ptr->basic.marked = 0;
+		// `index` itself isn't pinned, so this stops at or before it.
+		while (is_pinned(next))
+			++next;
+
+		forwards[index] = next++;
+	}
+
+	sq_program_relocate(program);
+	sq_gc_relocate(&sq_current_exception);
+
+	for (size_t i = 0; i < mutated.length; ++i) {
+		struct sq_basic *parent = mutated.ptrs[i];
+		sq_value_relocate(sq_value_new_ptr_unchecked((void *) parent, parent->genus));
+	}
+
+	EACH_LIVE(index, words)
+		sq_value_relocate(value_for(&heap_start[index]));
+
+	size_t moved = slide(words);
+	free_word = 0;
+	pinned_holes = index_of(heap) - traced;
+
+	for (size_t chunk = 0; chunk * SQ_GC_CHUNK_SIZE < used; ++chunk)
+		release_chunk_if_empty(chunk);
+
+	free(forwards);
+	free(pins);
+
+	++stats.compactions;
+	stats.moved += moved;
+	record_pause(start);
+
+	sq_log(gc, 1, "compaction finished: %zu moved, heap now %zu values", moved, index_of(heap));
+}
+
+void sq_gc_deduplicate_texts(void) {
+	deduplication_requested = false;
+
+	uint64_t start = now();
+	size_t words = (index_of(heap) + BITS_PER_WORD - 1) / BITS_PER_WORD, texts = 0, bytes = 0;
+
+	// Young texts are left alone, as most of them won't live long enough to be worth it.
+	EACH_LIVE(index, words) {
+		struct anyvalue *cell = &heap_start[index];
+
+		if (cell->basic.genus != SQ_G_TEXT || !cell->basic.old || is_garbage(index))
 			continue;
+
+		size_t freed = sq_text_deduplicate((struct sq_text *) cell);
+
+		if (freed) {
+			++texts;
+			bytes += freed;
 		}
+	}
+
+	stats.deduplicated += texts;
+	stats.deduplicated_bytes += bytes;
+	record_pause(start);
+
+	sq_log(gc, 1, "deduplicated %zu texts, saving %zu bytes", texts, bytes);
+}
+
+void sq_gc_safepoint(void) {
+	// Compacting collects everything first, which may find more texts to deduplicate.
+	if (compaction_requested)
+		sq_gc_compact();
+
+	if (deduplication_requested)
+		sq_gc_deduplicate_texts();
+
+	sq_gc_safepoint_pending = false;
+}
+
+const char *const sq_gc_pause_names[SQ_GC_PAUSE_BUCKETS] = {
+	"100us", "1ms", "10ms", "100ms", "1s", "longer"
+};
+
+const char *const sq_gc_genus_names[1 << SQ_GENUS_TAG_BITS] = {
+	[SQ_G_OTHER] = "Other", [SQ_G_NUMERAL] = "Numeral", [SQ_G_TEXT] = "Text",
+	[SQ_G_FORM] = "Form", [SQ_G_IMITATION] = "Imitation", [SQ_G_JOURNEY] = "Journey",
+	[SQ_G_BOOK] = "Book", [SQ_G_CODEX] = "Codex"
+};
+
+void sq_gc_read_stats(struct sq_gc_stats *out) {
+	update_peaks();
+	stats.committed = committed * SQ_VALUE_SIZE;
+	*out = stats;
+}
 
-		sq_log(gc, 2, "ptr %p is in unmarked", heap);
-		INCR_METRIC(freed);
+void sq_gc_dump_stats(FILE *out) {
+	struct sq_gc_stats current;
+	sq_gc_read_stats(&current);
 
-		sq_value_deallocate(sq_value_new_ptr_unchecked((void *) ptr, ptr->basic.genus));
-		ptr->basic.in_use = 0;
+	fprintf(out, "{\n\t\"collections\": { \"nursery\": %zu, \"full\": %zu },\n",
+		current.nursery_collections, current.full_collections);
+	fprintf(out, "\t\"compactions\": { \"count\": %zu, \"moved\": %zu },\n",
+		current.compactions, current.moved);
+	fprintf(out, "\t\"deduplicated\": { \"texts\": %zu, \"bytes_saved\": %zu },\n",
+		current.deduplicated, current.deduplicated_bytes);
+
+	fprintf(out, "\t\"pauses\": {\n\t\t\"total_ns\": %llu,\n\t\t\"longest_ns\": %llu,\n",
+		(unsigned long long) current.total_pause, (unsigned long long) current.longest_pause);
+	fprintf(out, "\t\t\"histogram\": {");
+
+	for (unsigned i = 0; i < SQ_GC_PAUSE_BUCKETS; ++i)
+		fprintf(out, "%s \"%s\": %zu", i ? "," : "", sq_gc_pause_names[i], current.pauses[i]);
+
+	fprintf(out, " }\n\t},\n\t\"allocated\": {\n");
+
+	for (unsigned i = 0, first = 1; i < (1 << SQ_GENUS_TAG_BITS); ++i) {
+		// Numerals are never allocated.
+		if (i == SQ_G_NUMERAL)
+			continue;
+
+		fprintf(out, "%s\t\t\"%s\": { \"values\": %zu, \"bytes\": %zu }", first ? "" : ",\n",
+			sq_gc_genus_names[i], current.allocated[i], current.allocated[i] * SQ_VALUE_SIZE);
+		first = 0;
 	}
 
-	sq_log(gc, 1, "gc finished: %lu unused, %lu marked, %lu freed", unused, marked, freed);
-	heap = heap_start;
+	fprintf(out, "\n\t},\n\t\"heap\": {\n");
+	fprintf(out, "\t\t\"live\": %zu,\n\t\t\"peak_live\": %zu,\n", current.live, current.peak_live);
+	fprintf(out, "\t\t\"live_bytes\": %zu,\n\t\t\"peak_live_bytes\": %zu,\n",
+		current.live * SQ_VALUE_SIZE, current.peak_live * SQ_VALUE_SIZE);
+	fprintf(out, "\t\t\"committed_bytes\": %zu,\n\t\t\"maximum_bytes\": %zu,\n",
+		current.committed, reserved * SQ_VALUE_SIZE);
+	fprintf(out, "\t\t\"permanent\": %zu\n\t}\n}\n", current.permanent);
+}
+
+void sq_gc_each_live(void (*visit)(sq_value, const struct sq_gc_site *, void *), void *data) {
+	if (!paused)
+		collect_everything();
+
+	size_t words = (index_of(heap) + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+	EACH_LIVE(index, words)
+		if (!is_garbage(index))
+			visit(value_for(&heap_start[index]), sites == NULL ? NULL : &sites[index], data);
+}
+
+static void nursery_is_full(void) {
+	if (paused) {
+		nursery.capacity *= 2;
+		nursery.ptrs = sq_realloc_vec(void *, nursery.ptrs, nursery.capacity);
+		return;
+	}
+
+	collect_nursery();
+
+	if (major_threshold <= old_count)
+		collect_everything();
+}
+
+static struct anyvalue *find_free_cell(void) {
+	for (; free_word < committed / BITS_PER_WORD; ++free_word) {
+		if (SQ_UNLIKELY(sweep_word <= free_word && sweep_word < sweep_end))
+			sweep_some();
+
+		uint64_t free_bits = ~allocated[free_word];
+
+		if (!free_bits)
+			continue;
+
+		unsigned bit = __builtin_ctzll(free_bits);
+		allocated[free_word] |= 1ULL << bit;
+
+		struct anyvalue *cell = &heap_start[free_word * BITS_PER_WORD + bit];
+
+		if (heap <= cell)
+			heap = cell + 1;
+
+		return cell;
+	}
+
+	return NULL;
+}
+
+static struct anyvalue *next_cell(void) {
+	struct anyvalue *cell;
+
+	if (SQ_LIKELY((cell = find_free_cell()) != NULL))
+		return cell;
+
+	if (!paused) {
+		collect_everything();
+
+		// Grow the heap if it's mostly live, rather than collecting again as soon as the little
+		// that was freed is used up.
+		if (committed < 2 * traced)
+			grow_heap();
+
+		if ((cell = find_free_cell()) != NULL)
+			return cell;
+	}
+
+	if (!grow_heap()) {
+		mutator_top = NULL;
+		sq_throw("heap exhausted.");
+	}
+
+	return find_free_cell();
+}
+
+static void record_site(const struct anyvalue *cell) {
+	struct sq_gc_site *site = &sites[index_of(cell)];
+
+	if (sq_current_stackframe == 0) {
+		site->journey = NULL;
+		site->ip = 0;
+	} else {
+		site->journey = sq_stackframes[sq_current_stackframe - 1].journey;
+		site->ip = sq_stackframes[sq_current_stackframe - 1].ip;
+	}
+}
+
+SQ_NOINLINE
+static struct anyvalue *collect_then_allocate(void) {
+	// Spill the mutator's callee-saved registers here, so only they and the frames above this
+	// one need to be scanned.
+	jmp_buf registers;
+	setjmp(registers);
+#if SQ_HAS_BUILTIN(__builtin_unwind_init)
+	__builtin_unwind_init();
+#endif
+	mutator_top = (uintptr_t *) &registers;
+
+	if (nursery.length == nursery.capacity)
+		nursery_is_full();
+
+	struct anyvalue *cell = next_cell();
+	mutator_top = NULL;
+	return cell;
+}
+
+void *sq_gc_malloc(enum sq_genus_tag genus) {
+	if (SQ_UNLIKELY(permanent_depth))
+		return allocate_permanent(genus);
+
+	struct anyvalue *cell;
+
+	if (SQ_UNLIKELY(nursery.length == nursery.capacity) || SQ_UNLIKELY(!(cell = find_free_cell())))
+		cell = collect_then_allocate();
+
+	// Values are zeroed so that ones which are marked or freed before they're fully initialized
+	// (eg if an exception is thrown in the middle) don't have garbage in them.
+	memset(cell, 0, sizeof *cell);
+	cell->basic.genus = genus;
+	cell->basic.in_use = 1;
+
+	if (SQ_UNLIKELY(sites != NULL))
+		record_site(cell);
+
+	nursery.ptrs[nursery.length++] = cell;
+	++stats.allocated[genus];
+	++stats.live;
+	sq_log(gc, 2, "allocated value at address %p", (void *) cell);
+	return cell;
 }
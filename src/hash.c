@@ -0,0 +1,74 @@
+#include <squire/hash.h>
+#include <string.h>
+
+#define PRIME1 0x9e3779b185ebca87ULL
+#define PRIME2 0xc2b2ae3d27d4eb4fULL
+#define PRIME3 0x165667b19e3779f9ULL
+#define PRIME4 0x27d4eb2f165667c5ULL
+
+#define LANES 4
+#define BLOCK_SIZE (LANES * sizeof(uint64_t))
+
+static inline uint64_t read64(const unsigned char *bytes) {
+	uint64_t word;
+	memcpy(&word, bytes, sizeof word);
+	return word;
+}
+
+static inline uint64_t rotl64(uint64_t word, unsigned amnt) {
+	return (word << amnt) | (word >> (64 - amnt));
+}
+
+static inline uint64_t mix64(uint64_t acc, uint64_t word) {
+	return rotl64(acc ^ (word * PRIME2), 31) * PRIME1;
+}
+
+/*
+ * Long inputs are consumed a block at a time by `LANES` independent accumulators
+ * which only use 32x32->64 bit multiplies (the same trick as xxh3). The lanes don't
+ * depend on one another, so this loop is vectorized by the compiler on any target
+ * that has SIMD (SSE2, AVX2, NEON, ...) without needing any intrinsics.
+ */
+static uint64_t hash_blocks(const unsigned char **bytesp, size_t *lengthp) {
+	static const uint64_t keys[LANES] = { PRIME1, PRIME2, PRIME3, PRIME4 };
+	uint64_t lanes[LANES] = { PRIME3, PRIME4, PRIME1, PRIME2 };
+	const unsigned char *bytes = *bytesp;
+	size_t length = *lengthp;
+
+	for (; BLOCK_SIZE <= length; bytes += BLOCK_SIZE, length -= BLOCK_SIZE) {
+		for (unsigned i = 0; i < LANES; ++i) {
+			uint64_t word = read64(bytes + i * sizeof(uint64_t));
+			uint64_t keyed = word ^ keys[i];
+
+			lanes[i] += word + (keyed & 0xffffffff) * (keyed >> 32);
+		}
+	}
+
+	*bytesp = bytes;
+	*lengthp = length;
+
+	uint64_t acc = 0;
+	for (unsigned i = 0; i < LANES; ++i)
+		acc = mix64(acc, lanes[i]);
+
+	return acc;
+}
+
+sq_hash sq_hash_bytes(const void *ptr, size_t length) {
+	const unsigned char *bytes = ptr;
+	uint64_t acc = PRIME4 ^ (length * PRIME1);
+
+	if (BLOCK_SIZE <= length)
+		acc = mix64(acc, hash_blocks(&bytes, &length));
+
+	for (; sizeof(uint64_t) <= length; bytes += sizeof(uint64_t), length -= sizeof(uint64_t))
+		acc = mix64(acc, read64(bytes));
+
+	if (length) {
+		uint64_t tail = 0;
+		memcpy(&tail, bytes, length);
+		acc = mix64(acc, tail);
+	}
+
+	return sq_hash_finish(acc);
+}
@@ -1,22 +1,138 @@
 #include <squire/program.h>
 #include <squire/shared.h>
 #include <squire/gc.h>
+#include <squire/census.h>
+#include <squire/profile.h>
+#include <squire/opcount.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+// Options which can also be set through the environment, as `SQUIRE_HEAP_INITIAL` etc.
+static const char *const gc_options[][2] = {
+	{ "heap-initial", "SQUIRE_HEAP_INITIAL" },
+	{ "heap-max", "SQUIRE_HEAP_MAX" },
+	{ "heap-growth", "SQUIRE_HEAP_GROWTH" },
+	{ "compact-threshold", "SQUIRE_COMPACT_THRESHOLD" },
+	{ "allocation-sites", "SQUIRE_ALLOCATION_SITES" },
+	{ "heap-backing", "SQUIRE_HEAP_BACKING" },
+	{ "dedup-texts", "SQUIRE_DEDUP_TEXTS" },
+	{ "sweep-budget", "SQUIRE_SWEEP_BUDGET" },
+};
+
+// Where `--gc-stats` writes the gc's counters when the program exits.
+static const char *gc_stats_file;
+
+// What `--census` names the files heap censuses are written to when `SIGUSR1` is received.
+static const char *census_prefix;
+
+// Where `--profile` writes the journeys it sampled when the program exits.
+static const char *profile_file;
+
+#ifdef SQ_COUNT_OPCODES
+// Instrumented builds always write their counts when the program exits, to the file named by
+// `SQUIRE_OPCODE_COUNTS` or otherwise to stderr.
+static void dump_opcode_counts(void) {
+	const char *path = getenv("SQUIRE_OPCODE_COUNTS");
+	FILE *out = path != NULL ? fopen(path, "w") : stderr;
+
+	if (out == NULL) {
+		perror(path);
+		return;
+	}
+
+	sq_opcount_write(out);
+
+	if (out != stderr)
+		fclose(out);
+}
+#endif /* SQ_COUNT_OPCODES */
+
+static int usage(const char *name) {
+	fprintf(stderr, "usage: %s [--heap-initial=SIZE] [--heap-max=SIZE] [--heap-growth=FACTOR] "
+		"[--heap-backing=default|huge,prefault] [--compact-threshold=PERCENT] "
+		"[--allocation-sites=0|1] [--dedup-texts=0|1] [--sweep-budget=WORDS] [--gc-stats[=FILE]] "
+		"[--census=PREFIX] "
+		"[--profile=FILE] (-e 'expr' | -f 'filename')\n", name);
+	return 1;
+}
+
+static void dump_gc_stats(void) {
+	FILE *out = strcmp(gc_stats_file, "-") ? fopen(gc_stats_file, "w") : stderr;
+
+	if (out == NULL) {
+		perror(gc_stats_file);
+		return;
+	}
+
+	sq_gc_dump_stats(out);
+
+	if (out != stderr)
+		fclose(out);
+}
+
 int main(int argc, const char **argv) {
-	if (argc < 3 || (strcmp(argv[1], "-e") && strcmp(argv[1], "-f"))) {
-		fprintf(stderr, "usage: %s (-e 'expr' | -f 'filename')\n", argv[0]);
-		return 1;
+	const char *name = argv[0];
+
+	for (unsigned i = 0; i < sizeof(gc_options) / sizeof(gc_options[0]); ++i) {
+		const char *value = getenv(gc_options[i][1]);
+
+		if (value != NULL && !sq_gc_configure(gc_options[i][0], value)) {
+			fprintf(stderr, "%s: invalid %s: %s\n", name, gc_options[i][1], value);
+			return 1;
+		}
 	}
 
+	for (; 1 < argc && !strncmp(argv[1], "--", 2); --argc, ++argv) {
+		char option[64];
+
+		if (!strcmp(argv[1], "--gc-stats") || !strncmp(argv[1], "--gc-stats=", 11)) {
+			gc_stats_file = argv[1][10] ? argv[1] + 11 : "-";
+			continue;
+		}
+
+		if (!strncmp(argv[1], "--census=", 9)) {
+			census_prefix = argv[1] + 9;
+			continue;
+		}
+
+		if (!strncmp(argv[1], "--profile=", 10)) {
+			profile_file = argv[1] + 10;
+			continue;
+		}
+
+		const char *value = strchr(argv[1], '=');
+
+		if (value == NULL || sizeof option <= (size_t) (value - argv[1] - 2))
+			return usage(name);
+
+		memcpy(option, argv[1] + 2, value - argv[1] - 2);
+		option[value - argv[1] - 2] = '\0';
+
+		if (!sq_gc_configure(option, value + 1)) {
+			fprintf(stderr, "%s: invalid option: %s\n", name, argv[1]);
+			return 1;
+		}
+	}
+
+	if (argc < 3 || (strcmp(argv[1], "-e") && strcmp(argv[1], "-f")))
+		return usage(name);
+
 	struct sq_program program;
-#ifndef SQ_GC_HEAP_SIZE
-# define SQ_GC_HEAP_SIZE 100000000
-#endif
-	sq_gc_init(SQ_GC_HEAP_SIZE, &program);
+	sq_gc_init(&program);
+
+	if (gc_stats_file != NULL)
+		atexit(dump_gc_stats);
+
+	sq_census_on_signal(census_prefix);
+
+	if (profile_file != NULL)
+		sq_profile_start(profile_file);
+
+#ifdef SQ_COUNT_OPCODES
+	atexit(dump_opcode_counts);
+#endif /* SQ_COUNT_OPCODES */
 
 	if (argv[1][1] == 'e') {
 		sq_program_compile(&program, argv[2]);
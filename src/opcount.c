@@ -0,0 +1,113 @@
+#include <squire/opcount.h>
+
+#ifdef SQ_COUNT_OPCODES
+#include <squire/shared.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct sq_opcount sq_opcount;
+
+struct row {
+	const char *name, *second; // `second` is only for pairs.
+	size_t count;
+	uint64_t cycles;
+};
+
+static int compare_rows(const void *l, const void *r) {
+	const struct row *lhs = l, *rhs = r;
+
+	if (lhs->count != rhs->count)
+		return lhs->count < rhs->count ? 1 : -1;
+
+	int cmp = strcmp(lhs->name, rhs->name);
+
+	if (cmp || lhs->second == NULL)
+		return cmp;
+
+	return strcmp(lhs->second, rhs->second);
+}
+
+static size_t total(const size_t *counts) {
+	size_t sum = 0;
+
+	for (unsigned i = 0; i < SQ_OPCOUNT_SLOTS; ++i)
+		sum += counts[i];
+
+	return sum;
+}
+
+static void write_rows(FILE *out, const char *kind, struct row *rows, size_t length, size_t sum) {
+	qsort(rows, length, sizeof *rows, compare_rows);
+
+	for (size_t i = 0; i < length; ++i) {
+		fprintf(out, "%s\t%s", kind, rows[i].name);
+
+		if (rows[i].second != NULL)
+			fprintf(out, ",%s", rows[i].second);
+
+		fprintf(out, "\t%zu\t%.2f", rows[i].count, rows[i].count * 100.0 / sum);
+#ifdef SQ_COUNT_OPCODE_CYCLES
+		if (rows[i].second != NULL) // cycles aren't counted for pairs
+			fputs("\t-\t-", out);
+		else
+			fprintf(out, "\t%llu\t%.1f", (unsigned long long) rows[i].cycles,
+				(double) rows[i].cycles / rows[i].count);
+#endif /* SQ_COUNT_OPCODE_CYCLES */
+		fputc('\n', out);
+	}
+}
+
+void sq_opcount_write(FILE *out) {
+	struct row *rows = sq_malloc_vec(struct row, SQ_OPCOUNT_SLOTS * SQ_OPCOUNT_SLOTS);
+	size_t length = 0;
+
+#ifdef SQ_COUNT_OPCODE_CYCLES
+	fprintf(out, "# kind\tname\tcount\tpercent\tcycles\tcycles_per_count\n");
+#else
+	fprintf(out, "# kind\tname\tcount\tpercent\n");
+#endif /* SQ_COUNT_OPCODE_CYCLES */
+
+	for (unsigned i = 0; i < SQ_OPCOUNT_SLOTS; ++i) {
+		if (!sq_opcount.opcodes[i])
+			continue;
+
+		rows[length++] = (struct row) { .name = sq_opcode_repr(i), .count = sq_opcount.opcodes[i] };
+#ifdef SQ_COUNT_OPCODE_CYCLES
+		rows[length - 1].cycles = sq_opcount.opcode_cycles[i];
+#endif /* SQ_COUNT_OPCODE_CYCLES */
+	}
+
+	write_rows(out, "opcode", rows, length, total(sq_opcount.opcodes));
+	length = 0;
+
+	for (unsigned i = 0; i < SQ_OPCOUNT_SLOTS; ++i) {
+		if (!sq_opcount.interrupts[i])
+			continue;
+
+		rows[length++] = (struct row) { .name = sq_interrupt_repr(i), .count = sq_opcount.interrupts[i] };
+#ifdef SQ_COUNT_OPCODE_CYCLES
+		rows[length - 1].cycles = sq_opcount.interrupt_cycles[i];
+#endif /* SQ_COUNT_OPCODE_CYCLES */
+	}
+
+	write_rows(out, "interrupt", rows, length, total(sq_opcount.interrupts));
+	length = 0;
+
+	// The first opcode that's run follows `SQ_OC_UNDEFINED`, which isn't a real pair.
+	size_t pairs = total(sq_opcount.opcodes) - 1;
+
+	for (unsigned i = 1; i < SQ_OPCOUNT_SLOTS; ++i)
+		for (unsigned j = 0; j < SQ_OPCOUNT_SLOTS; ++j)
+			if (sq_opcount.pairs[i][j])
+				rows[length++] = (struct row) {
+					.name = sq_opcode_repr(i), .second = sq_opcode_repr(j), .count = sq_opcount.pairs[i][j]
+				};
+
+	// There are far more pairs than opcodes, so only the most common ones are written.
+	qsort(rows, length, sizeof *rows, compare_rows);
+	write_rows(out, "pair", rows, length < SQ_OPCOUNT_PAIRS_SHOWN ? length : SQ_OPCOUNT_PAIRS_SHOWN, pairs);
+
+	free(rows);
+}
+#endif /* SQ_COUNT_OPCODES */
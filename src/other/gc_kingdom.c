@@ -0,0 +1,104 @@
+#include <squire/other/other.h>
+#include <squire/other/kingdom.h>
+#include <squire/codex.h>
+#include <squire/text.h>
+#include <squire/gc.h>
+#include <squire/census.h>
+#include <squire/shared.h>
+
+#include <string.h>
+
+// Values are tagged in their lowest bits, so static ones must be aligned enough to fit them.
+#define BUILTIN_JOURNEY(_name, _nargs) \
+	static sq_value _name##_func(struct sq_args); \
+	static SQ_ALIGNAS(1 << SQ_VSHIFT) struct sq_other _name##_journey = { \
+		.basic = SQ_STATIC_BASIC(struct sq_other), \
+		.kind = SQ_OK_BUILTIN_JOURNEY, \
+		.builtin_journey = { .name = "Gc."#_name, .nargs = _nargs, .func = _name##_func } \
+	};
+
+BUILTIN_JOURNEY(stats, 1)
+BUILTIN_JOURNEY(collect, 1)
+BUILTIN_JOURNEY(census, 1)
+
+struct sq_other *sq_gc_kingdom_new(void) {
+	struct sq_other *kingdom = sq_mallocv(struct sq_other);
+
+	kingdom->kind = SQ_OK_KINGDOM;
+	sq_kingdom_initialize(&kingdom->kingdom, 3);
+	kingdom->kingdom.name = strdup("Gc");
+
+	sq_kingdom_set_attr(&kingdom->kingdom, "stats", sq_value_new_other(&stats_journey));
+	sq_kingdom_set_attr(&kingdom->kingdom, "collect", sq_value_new_other(&collect_journey));
+	sq_kingdom_set_attr(&kingdom->kingdom, "census", sq_value_new_other(&census_journey));
+
+	return kingdom;
+}
+
+static void set_count(struct sq_codex *codex, const char *name, size_t count) {
+	sq_codex_index_assign(codex,
+		sq_value_new_text(sq_text_new(strdup(name))),
+		sq_value_new_numeral((sq_numeral) count));
+}
+
+static sq_value stats_func(struct sq_args args) {
+	sq_journey_assert_arglen(args, 1, 0);
+
+	struct sq_gc_stats stats;
+	sq_gc_read_stats(&stats);
+
+	struct sq_codex *result = sq_codex_allocate(16);
+	struct sq_codex *pauses = sq_codex_allocate(SQ_GC_PAUSE_BUCKETS);
+	struct sq_codex *allocated = sq_codex_allocate(1 << SQ_GENUS_TAG_BITS);
+
+	set_count(result, "nursery_collections", stats.nursery_collections);
+	set_count(result, "full_collections", stats.full_collections);
+	set_count(result, "compactions", stats.compactions);
+	set_count(result, "moved", stats.moved);
+	set_count(result, "deduplicated", stats.deduplicated);
+	set_count(result, "deduplicated_bytes", stats.deduplicated_bytes);
+	set_count(result, "total_pause", stats.total_pause);
+	set_count(result, "longest_pause", stats.longest_pause);
+	set_count(result, "permanent", stats.permanent);
+	set_count(result, "live", stats.live);
+	set_count(result, "peak_live", stats.peak_live);
+	set_count(result, "committed", stats.committed);
+
+	for (unsigned i = 0; i < SQ_GC_PAUSE_BUCKETS; ++i)
+		set_count(pauses, sq_gc_pause_names[i], stats.pauses[i]);
+
+	for (unsigned i = 0; i < (1 << SQ_GENUS_TAG_BITS); ++i)
+		if (i != SQ_G_NUMERAL)
+			set_count(allocated, sq_gc_genus_names[i], stats.allocated[i]);
+
+	sq_codex_index_assign(result, sq_value_new_text(sq_text_new(strdup("pauses"))),
+		sq_value_new_codex(pauses));
+	sq_codex_index_assign(result, sq_value_new_text(sq_text_new(strdup("allocated"))),
+		sq_value_new_codex(allocated));
+
+	return sq_value_new_codex(result);
+}
+
+static sq_value collect_func(struct sq_args args) {
+	sq_journey_assert_arglen(args, 1, 0);
+
+	sq_gc_start();
+	return SQ_NI;
+}
+
+// Returns the same report that `SIGUSR1` writes, as text.
+static sq_value census_func(struct sq_args args) {
+	sq_journey_assert_arglen(args, 1, 0);
+
+	char *report;
+	size_t length;
+	FILE *out = open_memstream(&report, &length);
+
+	if (out == NULL)
+		sq_throw_io("unable to take a census");
+
+	sq_census_write(out);
+	fclose(out);
+
+	return sq_value_new_text(sq_text_new2(report, length));
+}
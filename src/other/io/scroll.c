@@ -14,12 +14,21 @@
 // };
 // struct sq_kingdom *sq_scroll_kingdom = &scroll_kingdom;
 
-static sq_value write_journey, write_func(struct sq_args);
-static sq_value read_journey, read_func(struct sq_args);
-static sq_value readall_journey, readall_func(struct sq_args);
-static sq_value seek_journey, seek_func(struct sq_args);
-static sq_value close_journey, close_func(struct sq_args);
-static sq_value tell_journey, tell_func(struct sq_args);
+// Values are tagged in their lowest bits, so static ones must be aligned enough to fit them.
+#define BUILTIN_JOURNEY(_name, _nargs) \
+	static sq_value _name##_func(struct sq_args); \
+	static SQ_ALIGNAS(1 << SQ_VSHIFT) struct sq_other _name##_journey = { \
+		.basic = SQ_STATIC_BASIC(struct sq_other), \
+		.kind = SQ_OK_BUILTIN_JOURNEY, \
+		.builtin_journey = { .name = "Scroll."#_name, .nargs = _nargs, .func = _name##_func } \
+	};
+
+BUILTIN_JOURNEY(write, 2)
+BUILTIN_JOURNEY(read, 2)
+BUILTIN_JOURNEY(readall, 2)
+BUILTIN_JOURNEY(seek, 3)
+BUILTIN_JOURNEY(close, 1)
+BUILTIN_JOURNEY(tell, 1)
 
 void sq_scroll_init(struct sq_scroll *scroll, const char *filename, const char *mode) {
 	if (!(scroll->file = fopen(filename, mode)))
@@ -27,21 +36,6 @@ void sq_scroll_init(struct sq_scroll *scroll, const char *filename, const char *
 
 	scroll->filename = strdup(filename);
 	scroll->mode = strdup(mode);
-
-	struct sq_other *other;
-#define NEW_JOURNEY(_name, _nargs) \
-	_name##_journey = sq_value_new_other(other = sq_mallocv(struct sq_other)); \
-	other->kind = SQ_OK_BUILTIN_JOURNEY; \
-	other->builtin_journey.name = "Scroll."#_name; \
-	other->builtin_journey.nargs = _nargs; \
-	other->builtin_journey.func = _name##_func; 
-
-	NEW_JOURNEY(write, 2);
-	NEW_JOURNEY(read, 2);
-	NEW_JOURNEY(readall, 2);
-	NEW_JOURNEY(seek, 3);
-	NEW_JOURNEY(close, 1);
-	NEW_JOURNEY(tell, 1);
 }
 
 void sq_scroll_dump(FILE *out, const struct sq_scroll *scroll) {
@@ -51,7 +45,10 @@ void sq_scroll_dump(FILE *out, const struct sq_scroll *scroll) {
 void sq_scroll_deallocate(struct sq_scroll *scroll) {
 	free(scroll->filename);
 	free(scroll->mode);
-	fclose(scroll->file);
+
+	// `file` is null if the scroll couldn't be opened.
+	if (scroll->file != NULL)
+		fclose(scroll->file);
 }
 
 sq_value sq_scroll_get_attr(const struct sq_scroll *scroll, const char *attr) {
@@ -61,12 +58,12 @@ sq_value sq_scroll_get_attr(const struct sq_scroll *scroll, const char *attr) {
 	if (!strcmp(attr, "mode"))
 		return sq_value_new_text(sq_text_new(strdup(scroll->mode)));
 
-	if (!strcmp(attr, "write")) return write_journey;
-	if (!strcmp(attr, "read")) return read_journey;
-	if (!strcmp(attr, "seek")) return seek_journey;
-	if (!strcmp(attr, "tell")) return tell_journey;
-	if (!strcmp(attr, "close")) return close_journey;
-	if (!strcmp(attr, "readall")) return readall_journey;
+	if (!strcmp(attr, "write")) return sq_value_new_other(&write_journey);
+	if (!strcmp(attr, "read")) return sq_value_new_other(&read_journey);
+	if (!strcmp(attr, "seek")) return sq_value_new_other(&seek_journey);
+	if (!strcmp(attr, "tell")) return sq_value_new_other(&tell_journey);
+	if (!strcmp(attr, "close")) return sq_value_new_other(&close_journey);
+	if (!strcmp(attr, "readall")) return sq_value_new_other(&readall_journey);
 
 	return SQ_UNDEFINED;
 }
@@ -92,6 +89,7 @@ struct sq_text *sq_scroll_read(struct sq_scroll *scroll, size_t length) {
 	}
 
 	text->ptr[position] = '\0';
+	text->length = position;
 	return text;
 }
 
@@ -146,12 +144,17 @@ static sq_value read_func(struct sq_args args) {
 			sq_throw("todo: non-newline gets");
 
 		{
-			size_t length;
-			char *result = fgetln(scroll->file, &length);
+			// `getline` is POSIX, unlike `fgetln`, so this builds on linux too.
+			char *result = NULL;
+			size_t capacity = 0;
+			ssize_t length = getline(&result, &capacity, scroll->file);
 
-			if (!result) sq_throw(strerror(errno));
+			if (length < 0) {
+				free(result);
+				sq_throw(strerror(errno));
+			}
 
-			return sq_value_new_text(sq_text_new(strndup(result, length)));
+			return sq_value_new_text(sq_text_new2(result, length));
 		}
 
 	case SQ_G_OTHER:
@@ -67,6 +67,31 @@ void sq_other_mark(struct sq_other *other) {
 	}
 }
 
+// Externals can't be relocated, so the heap isn't compacted while there are any.
+void sq_other_relocate(struct sq_other *other) {
+	switch (other->kind) {
+	case SQ_OK_SCROLL:
+	case SQ_OK_ENVOY:
+	case SQ_OK_BUILTIN_JOURNEY:
+	case SQ_OK_EXTERNAL:
+		break;
+
+	case SQ_OK_KINGDOM:
+		for (unsigned i = 0; i < sq_other_as_kingdom(other)->nsubjects; ++i)
+			sq_gc_relocate(&sq_other_as_kingdom(other)->subjects[i].person);
+		break;
+
+	case SQ_OK_CITATION:
+		// Citations point at stackframes' locals, which are relocated along with them.
+		break;
+
+	case SQ_OK_PAT_HELPER:
+		sq_gc_relocate(&sq_other_as_pattern_helper(other)->left);
+		sq_gc_relocate(&sq_other_as_pattern_helper(other)->right);
+		break;
+	}
+}
+
 void sq_other_deallocate(struct sq_other *other) {
 	switch (other->kind) {
 	case SQ_OK_SCROLL:
@@ -232,6 +257,8 @@ sq_value sq_other_get_attr(const struct sq_other *other, const char *attr) {
 }
 
 bool sq_other_set_attr(struct sq_other *other, const char *attr, sq_value value) {
+	sq_gc_write_barrier(&other->basic, value);
+
 	switch (other->kind) {
 	case SQ_OK_EXTERNAL:
 		return sq_external_set_attr(sq_other_as_external(other), attr, value);
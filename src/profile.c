@@ -0,0 +1,157 @@
+#include <squire/profile.h>
+#include <squire/journey.h>
+#include <squire/shared.h>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// Stacks share this many frames between them, on average, before samples are dropped.
+#define MAX_FRAMES (SQ_PROFILE_MAX_STACKS * 16)
+
+// Where the samples are written to when the program exits.
+static const char *profile_path;
+
+struct frame {
+	const struct sq_journey *journey;
+	unsigned ip;
+};
+
+// A distinct stack, and how many samples it was seen in.
+struct stack {
+	size_t hash, count; // if `count` is zero, the slot is empty.
+	unsigned start, depth;
+	bool truncated; // if the stack was deeper than `SQ_PROFILE_MAX_DEPTH`.
+};
+
+// Only twice as many slots as stacks are used, so probing always finds an empty one quickly.
+static struct stack *stacks;
+static struct frame *frames;
+static size_t nstacks, nframes, dropped;
+
+// The timer's signal can be handled by any thread, so only one may sample at a time.
+static bool sampling;
+
+static bool same_stack(const struct stack *stack, unsigned first, bool truncated) {
+	if (stack->depth != sq_current_stackframe - first || stack->truncated != truncated)
+		return false;
+
+	for (unsigned i = 0; i < stack->depth; ++i) {
+		const struct sq_stackframe *sf = &sq_stackframes[first + i];
+
+		if (frames[stack->start + i].journey != sf->journey || frames[stack->start + i].ip != sf->ip)
+			return false;
+	}
+
+	return true;
+}
+
+static void take_sample(int signal) {
+	(void) signal;
+
+	if (__atomic_test_and_set(&sampling, __ATOMIC_ACQUIRE))
+		return;
+
+	unsigned depth = sq_current_stackframe, first = 0;
+	bool truncated = SQ_PROFILE_MAX_DEPTH < depth;
+
+	if (truncated)
+		first = depth - SQ_PROFILE_MAX_DEPTH;
+
+	size_t hash = truncated;
+	for (unsigned i = first; i < depth; ++i)
+		hash = (hash * 31 + (size_t) sq_stackframes[i].journey) * 31 + sq_stackframes[i].ip;
+
+	size_t index = hash % (SQ_PROFILE_MAX_STACKS * 2);
+	for (; stacks[index].count; index = (index + 1) % (SQ_PROFILE_MAX_STACKS * 2)) {
+		if (stacks[index].hash == hash && same_stack(&stacks[index], first, truncated)) {
+			++stacks[index].count;
+			goto done;
+		}
+	}
+
+	if (nstacks == SQ_PROFILE_MAX_STACKS || MAX_FRAMES - nframes < depth - first) {
+		++dropped;
+		goto done;
+	}
+
+	stacks[index] = (struct stack) {
+		.hash = hash, .count = 1, .start = nframes, .depth = depth - first, .truncated = truncated
+	};
+
+	for (unsigned i = first; i < depth; ++i)
+		frames[nframes++] = (struct frame) {
+			.journey = sq_stackframes[i].journey, .ip = sq_stackframes[i].ip
+		};
+
+	++nstacks;
+
+done:
+	__atomic_clear(&sampling, __ATOMIC_RELEASE);
+}
+
+void sq_profile_write(FILE *out) {
+	for (size_t i = 0; i < SQ_PROFILE_MAX_STACKS * 2; ++i) {
+		const struct stack *stack = &stacks[i];
+
+		if (!stack->count)
+			continue;
+
+		if (stack->truncated)
+			fputs("...;", out);
+
+		// Samples can be taken before the first journey starts, or after the last one ends.
+		if (!stack->depth)
+			fputs("<native>", out);
+
+		for (unsigned j = 0; j < stack->depth; ++j) {
+			const struct frame *frame = &frames[stack->start + j];
+
+			// A stackframe is counted just before it's set, so it may not have a journey yet.
+			fprintf(out, "%s%s@%u", j ? ";" : "",
+				frame->journey ? frame->journey->name : "<native>", frame->ip);
+		}
+
+		fprintf(out, " %zu\n", stack->count);
+	}
+
+	if (dropped)
+		fprintf(out, "<dropped> %zu\n", dropped);
+}
+
+static void stop_and_write(void) {
+	struct itimerval stop = { 0 };
+	setitimer(ITIMER_PROF, &stop, NULL);
+
+	FILE *out = fopen(profile_path, "w");
+
+	if (out == NULL) {
+		perror(profile_path);
+		return;
+	}
+
+	sq_profile_write(out);
+	fclose(out);
+}
+
+void sq_profile_start(const char *path) {
+	profile_path = path;
+	stacks = sq_calloc(SQ_PROFILE_MAX_STACKS * 2, sizeof(struct stack));
+	frames = sq_malloc_vec(struct frame, MAX_FRAMES);
+
+	struct sigaction action = { .sa_handler = take_sample };
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+
+	if (sigaction(SIGPROF, &action, NULL))
+		sq_throw_io("unable to handle SIGPROF");
+
+	struct timeval every = { SQ_PROFILE_INTERVAL / 1000000, SQ_PROFILE_INTERVAL % 1000000 };
+	struct itimerval interval = { .it_interval = every, .it_value = every };
+
+	if (setitimer(ITIMER_PROF, &interval, NULL))
+		sq_throw_io("unable to start profiling");
+
+	atexit(stop_and_write);
+}
@@ -28,6 +28,8 @@ const char *sq_interrupt_repr(enum sq_interrupt interrupt) {
 	case SQ_INT_BOOK_NEW: return "SQ_INT_BOOK_NEW";
 	case SQ_INT_ARRAY_INSERT: return "SQ_INT_ARRAY_INSERT";
 	case SQ_INT_ARRAY_DELETE: return "SQ_INT_ARRAY_DELETE";
+	case SQ_INT_SORT: return "SQ_INT_SORT";
+	case SQ_INT_SORT_BY: return "SQ_INT_SORT_BY";
 
 	case SQ_INT_ARABIC: return "SQ_INT_ARABIC";
 	case SQ_INT_ROMAN: return "SQ_INT_ROMAN";
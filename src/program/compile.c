@@ -4,9 +4,11 @@
 #include <squire/parse.h>
 #include <squire/form.h>
 #include <squire/text.h>
+#include <squire/other/kingdom.h>
 
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 
 static struct sq_program *program;
 
@@ -30,7 +32,8 @@ struct sq_code {
 	unsigned codecap, codelen;
 	union sq_bytecode *bytecode;
 
-	unsigned nlocals;
+	unsigned nlocals, livecap;
+	struct sq_live_range *live; // an `end` of `0` means the local's statement isn't finished.
 
 	struct {
 		unsigned cap, len;
@@ -53,6 +56,7 @@ struct sq_code {
 	struct {
 		unsigned cap, len;
 		sq_value *ary;
+		unsigned *buckets; // `cap * 2` buckets of `index + 1`, or `0` for unused.
 	} consts;
 };
 
@@ -95,13 +99,34 @@ static void set_target_to_codelen(struct sq_code *code, unsigned target) {
 }
 
 static unsigned next_local(struct sq_code *code) {
+	if (code->livecap <= code->nlocals) {
+		code->livecap = code->livecap ? code->livecap * 2 : 64;
+		code->live = sq_realloc_vec(struct sq_live_range, code->live, code->livecap);
+	}
+
+	code->live[code->nlocals].start = code->live[code->nlocals].end = 0;
 	return code->nlocals++;
 }
 
+static void index_constant(struct sq_code *code, unsigned index) {
+	unsigned mask = code->consts.cap * 2 - 1;
+	unsigned bucket = sq_value_hash(code->consts.ary[index]) & mask;
+
+	while (code->consts.buckets[bucket])
+		bucket = (bucket + 1) & mask;
+
+	code->consts.buckets[bucket] = index + 1;
+}
+
 static unsigned declare_constant(struct sq_code *code, sq_value value) {
 	if (code->consts.cap == code->consts.len) {
 		code->consts.cap *= 2;
 		code->consts.ary = sq_realloc_vec(sq_value, code->consts.ary, code->consts.cap);
+
+		free(code->consts.buckets);
+		code->consts.buckets = sq_calloc(code->consts.cap * 2, sizeof(unsigned));
+		for (unsigned i = 0; i < code->consts.len; ++i)
+			index_constant(code, i);
 	}
 
 #ifdef SQ_LOG
@@ -111,15 +136,21 @@ static unsigned declare_constant(struct sq_code *code, sq_value value) {
 #endif /* sq_log_old */
 
 	code->consts.ary[code->consts.len] = value;
+	index_constant(code, code->consts.len);
 	return code->consts.len++;
 }
 
 static int lookup_constant(struct sq_code *code, sq_value value) {
 	// check to see if we've declared the constant before. if so, reuse that.
-	for (unsigned i = 0; i < code->consts.len; ++i) {
-		if (sq_value_eql(code->consts.ary[i], value)) {
-			return -1; // TODO: THIS does not work because of a bug...
-		}
+	unsigned mask = code->consts.cap * 2 - 1;
+	unsigned bucket = sq_value_hash(value) & mask;
+
+	for (; code->consts.buckets[bucket]; bucket = (bucket + 1) & mask) {
+		unsigned index = code->consts.buckets[bucket] - 1;
+
+		if (SQ_VTAG(value) == SQ_VTAG(code->consts.ary[index])
+			&& sq_value_eql(code->consts.ary[index], value))
+			return index;
 	}
 
 	return -1;
@@ -128,18 +159,15 @@ static int lookup_constant(struct sq_code *code, sq_value value) {
 static unsigned new_constant(struct sq_code *code, sq_value value) {
 	int index = lookup_constant(code, value);
 
-	return (index == -1) ? declare_constant(code, value) : index;
+	return (index == -1) ? declare_constant(code, value) : (unsigned) index;
 }
 
 static unsigned load_constant(struct sq_code *code, sq_value value) {
-	int index = lookup_constant(code, value);
+	unsigned index;
 
-	// if we haven't encountered the value before, load it.
-	if (index == -1) {
-		set_opcode(code, SQ_OC_CLOAD);
-		set_index(code, declare_constant(code, value));
-		set_index(code, index = next_local(code));
-	}
+	set_opcode(code, SQ_OC_CLOAD);
+	set_index(code, new_constant(code, value));
+	set_index(code, index = next_local(code));
 
 	return index;
 }
@@ -270,6 +298,8 @@ static unsigned compile_expression(struct sq_code *code, struct expression *expr
 static unsigned compile_primary(struct sq_code *code, struct primary *primary);
 static void compile_statements(struct sq_code *code, struct statements *stmts);
 static struct sq_journey *compile_journey(struct journey_declaration *jd, bool is_method);
+static struct pattern *compile_pattern_expression(struct sq_code *code, struct expression *expr);
+static unsigned compile_match(struct sq_code *code, struct pattern *pattern, unsigned value);
 
 static void compile_form_declaration(struct sq_code *code, struct form_declaration *fdecl) {
 	struct sq_form *form = sq_form_new(fdecl->name);
@@ -524,11 +554,8 @@ static void compile_switch_statement(struct sq_code *code, struct switch_stateme
 	SQ_ALLOCA(int, jump_to_end_indices, sw->ncases + 1);
 
 	for (unsigned i = 0; i < sw->ncases; ++i) {
-		unsigned case_index = compile_expression(code, sw->cases[i].expr);
-		set_opcode(code, SQ_OC_MATCHES);
-		set_index(code, case_index);
-		set_index(code, condition_index);
-		set_index(code, case_index); // overwrite the case with the destination
+		unsigned case_index = compile_match(code,
+			compile_pattern_expression(code, sw->cases[i].expr), condition_index);
 
 		set_opcode(code, SQ_OC_JMP_TRUE);
 		set_index(code, case_index);
@@ -666,6 +693,9 @@ static unsigned compile_function_call(struct sq_code *code, struct function_call
 		CHECK_FOR_BUILTIN("slice",     SQ_INT_SUBSTR, 3);
 		CHECK_FOR_BUILTIN("insert",    SQ_INT_ARRAY_INSERT, 3);
 		CHECK_FOR_BUILTIN("delete",    SQ_INT_ARRAY_DELETE, 2); // `slay`?
+		if (fncall->argc == 2)
+			CHECK_FOR_BUILTIN("arrange", SQ_INT_SORT_BY, 2);
+		CHECK_FOR_BUILTIN("arrange",   SQ_INT_SORT, 1);
 
 		CHECK_FOR_BUILTIN("gamble",    SQ_INT_RANDOM, 0);
 		CHECK_FOR_BUILTIN("roman",     SQ_INT_ROMAN, 1);
@@ -992,9 +1022,155 @@ done:
 
 }
 
+/*
+ * Patterns built with `&`, `|` and `~` that are only ever matched against (like fork cases and
+ * argument genera) don't escape, so instead of allocating a pattern helper each time they're
+ * run, each operand is matched in turn, stopping early just as the helper would. Operands are
+ * all still evaluated beforehand, in order.
+ */
+struct pattern {
+	enum { PATTERN_OPERAND, PATTERN_AND, PATTERN_OR, PATTERN_NOT } kind;
+	unsigned operand;
+	struct pattern *left, *right; // `right` is only for `PATTERN_AND` and `PATTERN_OR`.
+};
+
+static unsigned compile_eql(struct sq_code *code, struct eql_expression *eql);
+
+static struct pattern *pattern_operand(unsigned operand) {
+	struct pattern *pattern = sq_mallocz(struct pattern);
+	pattern->kind = PATTERN_OPERAND;
+	pattern->operand = operand;
+	return pattern;
+}
+
+static struct pattern *compile_pattern_primary(struct sq_code *code, struct primary *primary) {
+	if (primary->kind != SQ_PS_PPAREN || !primary->expr)
+		return pattern_operand(compile_primary(code, primary));
+
+	struct expression *expr = primary->expr;
+	free(primary);
+	return compile_pattern_expression(code, expr);
+}
+
+static struct pattern *compile_pattern_cmp(struct sq_code *code, struct cmp_expression *cmp) {
+	// `~` is the only pattern operator between `cmp` and `primary`.
+	if (cmp->kind != SQ_PS_CADD || cmp->lhs->kind != SQ_PS_AMUL || cmp->lhs->lhs->kind != SQ_PS_MPOW
+		|| cmp->lhs->lhs->lhs->kind != SQ_PS_PUNARY)
+		return pattern_operand(compile_cmp(code, cmp));
+
+	struct unary_expression *unary = cmp->lhs->lhs->lhs->lhs;
+	struct pattern *pattern;
+
+	switch (unary->kind) {
+	case SQ_PS_UPRIMARY:
+		pattern = NULL;
+		break;
+
+	case SQ_PS_UPAT_NOT:
+		pattern = sq_mallocz(struct pattern);
+		pattern->kind = PATTERN_NOT;
+		break;
+
+	default:
+		return pattern_operand(compile_cmp(code, cmp));
+	}
+
+	free(cmp->lhs->lhs->lhs);
+	free(cmp->lhs->lhs);
+	free(cmp->lhs);
+	free(cmp);
+
+	struct pattern *operand = compile_pattern_primary(code, unary->rhs);
+	free(unary);
+
+	if (pattern == NULL)
+		return operand;
+
+	pattern->left = operand;
+	return pattern;
+}
+
+static struct pattern *compile_pattern_eql(struct sq_code *code, struct eql_expression *eql) {
+	struct pattern *pattern;
+
+	switch (eql->kind) {
+	case SQ_PS_EAND_PAT:
+	case SQ_PS_EOR_PAT:
+		pattern = sq_mallocz(struct pattern);
+		pattern->kind = eql->kind == SQ_PS_EAND_PAT ? PATTERN_AND : PATTERN_OR;
+		pattern->left = compile_pattern_cmp(code, eql->lhs);
+		pattern->right = compile_pattern_eql(code, eql->rhs);
+		break;
+
+	case SQ_PS_ECMP:
+		pattern = compile_pattern_cmp(code, eql->lhs);
+		break;
+
+	default:
+		return pattern_operand(compile_eql(code, eql));
+	}
+
+	free(eql);
+	return pattern;
+}
+
+static struct pattern *compile_pattern_expression(struct sq_code *code, struct expression *expr) {
+	if (expr->kind != SQ_PS_EMATH || expr->math->kind != SQ_PS_BEQL)
+		return pattern_operand(compile_expression(code, expr));
+
+	struct eql_expression *eql = expr->math->lhs;
+	free(expr->math);
+	return compile_pattern_eql(code, eql);
+}
+
+static void compile_pattern_match(struct sq_code *code, struct pattern *pattern, unsigned value, unsigned result) {
+	switch (pattern->kind) {
+	case PATTERN_OPERAND:
+		set_opcode(code, SQ_OC_MATCHES);
+		set_index(code, pattern->operand);
+		set_index(code, value);
+		set_index(code, result);
+		break;
+
+	case PATTERN_NOT:
+		compile_pattern_match(code, pattern->left, value, result);
+		set_opcode(code, SQ_OC_NOT);
+		set_index(code, result);
+		set_index(code, result);
+		break;
+
+	case PATTERN_AND:
+	case PATTERN_OR:
+		compile_pattern_match(code, pattern->left, value, result);
+		set_opcode(code, pattern->kind == PATTERN_AND ? SQ_OC_JMP_FALSE : SQ_OC_JMP_TRUE);
+		set_index(code, result);
+		unsigned dst_label = code->codelen;
+		set_index(code, 0);
+
+		compile_pattern_match(code, pattern->right, value, result);
+		set_target_to_codelen(code, dst_label);
+		break;
+	}
+
+	free(pattern);
+}
+
+// Returns the local that's set to whether `value` matches `pattern`.
+static unsigned compile_match(struct sq_code *code, struct pattern *pattern, unsigned value) {
+	unsigned result = next_local(code);
+	compile_pattern_match(code, pattern, value, result);
+	return result;
+}
+
 static unsigned compile_eql(struct sq_code *code, struct eql_expression *eql) {
 	unsigned lhs, rhs, result;
 
+	if (eql->kind == SQ_PS_EMATCHES) {
+		struct pattern *pattern = compile_pattern_cmp(code, eql->lhs);
+		result = compile_match(code, pattern, compile_eql(code, eql->rhs));
+		goto done;
+	}
+
 	lhs = compile_cmp(code, eql->lhs);
 	if (eql->kind != SQ_PS_CADD)
 		rhs = compile_eql(code, eql->rhs);
@@ -1002,7 +1178,6 @@ static unsigned compile_eql(struct sq_code *code, struct eql_expression *eql) {
 	switch (eql->kind) {
 	case SQ_PS_EEQL: set_opcode(code, SQ_OC_EQL); break;
 	case SQ_PS_ENEQ: set_opcode(code, SQ_OC_NEQ); break;
-	case SQ_PS_EMATCHES: set_opcode(code, SQ_OC_MATCHES); break;
 	case SQ_PS_EAND_PAT: set_opcode(code, SQ_OC_PAT_AND); break;
 	case SQ_PS_EOR_PAT: set_opcode(code, SQ_OC_PAT_OR); break;
 	case SQ_PS_ECMP: result = lhs; goto done;
@@ -1101,6 +1276,9 @@ static unsigned compile_function_call_old(struct sq_code *code, struct function_
 	BUILTIN_FN("slice",     SQ_INT_SUBSTR, 3);
 	BUILTIN_FN("insert",    SQ_INT_ARRAY_INSERT, 3);
 	BUILTIN_FN("delete",    SQ_INT_ARRAY_DELETE, 2); // `slay`?
+	if (fncall->arglen == 2)
+		BUILTIN_FN("arrange", SQ_INT_SORT_BY, 2);
+	BUILTIN_FN("arrange",   SQ_INT_SORT, 1);
 
 	BUILTIN_FN("read",      SQ_INT_PTR_GET, 1);
 	BUILTIN_FN("addend",    SQ_INT_PTR_SET, 2);
@@ -1421,7 +1599,7 @@ static void compile_throw_statement(struct sq_code *code, struct expression *thr
 	set_index(code, dst);
 }
 
-static void compile_statement(struct sq_code *code, struct statement *stmt) {
+static void compile_statement_kind(struct sq_code *code, struct statement *stmt) {
 	switch (stmt->kind) {
 	case SQ_PS_SGLOBAL: compile_global(code, stmt->gdecl); break;
 	case SQ_PS_SLOCAL: compile_local(code, stmt->ldecl); break;
@@ -1441,6 +1619,20 @@ static void compile_statement(struct sq_code *code, struct statement *stmt) {
 	}
 }
 
+// Temporaries are live from the start of the innermost statement they're made in to its end.
+static void compile_statement(struct sq_code *code, struct statement *stmt) {
+	unsigned start = code->codelen, first_local = code->nlocals;
+
+	compile_statement_kind(code, stmt);
+
+	for (unsigned i = first_local; i < code->nlocals; ++i) {
+		if (code->live[i].end == 0) {
+			code->live[i].start = start;
+			code->live[i].end = code->codelen;
+		}
+	}
+}
+
 static void compile_statements(struct sq_code *code, struct statements *stmts) {
 	for (unsigned i = 0; i < stmts->len; ++i)
 		compile_statement(code, stmts->stmts[i]);
@@ -1465,11 +1657,17 @@ static void compile_journey_pattern(
 	code.bytecode = sq_malloc_vec(union sq_bytecode, code.codecap);
 	code.bytecode = sq_malloc_vec(union sq_bytecode, code.codecap);
 
-	code.nlocals = pattern->pargc + pattern->kwargc + (pattern->splat ? 1 : 0) + (pattern->splatsplat ? 1 : 0);
+	code.nlocals = 0;
+	code.livecap = 0;
+	code.live = NULL;
+
+	for (unsigned i = 0; i < pattern->pargc + pattern->kwargc + pattern->splat + pattern->splatsplat; ++i)
+		next_local(&code);
 	code.consts.cap = 64;
 	code.consts.len = 0;
 	code.consts.ary = sq_malloc_vec(sq_value, code.consts.cap);
 	code.consts.ary = sq_malloc_vec(sq_value, code.consts.cap);
+	code.consts.buckets = sq_calloc(code.consts.cap * 2, sizeof(unsigned));
 
 	code.vars.len = 0;
 	code.vars.cap = SQ_JOURNEY_MAX_ARGC * 2 + 2; // *2 for both positional and kw, then +2 for splat and splatsplat
@@ -1502,7 +1700,8 @@ static void compile_journey_pattern(
 			pattern->pargv[i].genus_start = -1;
 		} else {
 			pattern->pargv[i].genus_start = code.codelen;
-			unsigned dst = compile_expression(&code, jp->pargv[i].genus);
+			unsigned dst = compile_match(&code,
+				compile_pattern_expression(&code, jp->pargv[i].genus), local_index - 1);
 			set_opcode(&code, SQ_OC_RETURN);
 			set_index(&code, dst);
 		}
@@ -1543,13 +1742,27 @@ static void compile_journey_pattern(
 	pattern->start_index = code.codelen;
 	compile_statements(&code, jp->body);
 
+	// Arguments, variables, and temporaries made outside of statements (eg for defaults) are
+	// always live.
+	for (unsigned i = 0; i < code.vars.len; ++i)
+		code.live[code.vars.ary[i].index].end = 0;
+
+	for (unsigned i = 0; i < code.nlocals; ++i) {
+		if (code.live[i].end == 0) {
+			code.live[i].start = 0;
+			code.live[i].end = UINT_MAX;
+		}
+	}
+
 	pattern->code.nlocals = code.nlocals;
+	pattern->code.live = code.live;
 	pattern->code.nconsts = code.consts.len;
 	pattern->code.codelen = code.codelen;
 	pattern->code.consts = code.consts.ary;
 	pattern->code.bytecode = code.bytecode;
 
 	// todo: free everything made by `code`.
+	free(code.consts.buckets);
 
 	return;
 }
@@ -1602,9 +1815,14 @@ static void setup_globals(void) {
 
 	globals.ary[globals.len  ].name = strdup("Codex");
 	globals.ary[globals.len++].value = sq_value_new_text(sq_text_new(strdup("Codex")));
+
+	globals.ary[globals.len  ].name = strdup("Gc");
+	globals.ary[globals.len++].value = sq_value_new_other(sq_gc_kingdom_new());
 }
 
 void sq_program_compile(struct sq_program *program_, const char *stream) {
+	// the values we create live as long as the program does, so they're never collected.
+	sq_gc_begin_permanent();
 	setup_globals();
 
 	program = program_;
@@ -1633,5 +1851,6 @@ void sq_program_compile(struct sq_program *program_, const char *stream) {
 
 	for (unsigned i = 0; i < program->nglobals; ++i)
 		program->globals[i] = globals.ary[i].value;
-	
+
+	sq_gc_end_permanent();
 }
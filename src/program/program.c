@@ -28,14 +28,26 @@ void sq_program_mark(struct sq_program *program) {
 		sq_stackframe_mark(&sq_stackframes[i]);
 }
 
+void sq_program_relocate(struct sq_program *program) {
+	for (unsigned i = 0; i < program->nglobals; ++i) {
+		if (program->globals[i] != SQ_UNDEFINED)
+			sq_gc_relocate(&program->globals[i]);
+	}
+
+	program->main = sq_gc_relocated(program->main);
+
+	for (unsigned i = 0; i < sq_current_stackframe; ++i)
+		sq_stackframe_relocate(&sq_stackframes[i]);
+}
+
 
 static sq_value create_argv(unsigned argc, const char **argv) {
-	sq_value *args = sq_malloc_vec(sq_value, argc);
+	struct sq_book *args = sq_book_allocate(argc);
 
 	for (unsigned i = 0; i < argc; ++i)
-		args[i] = sq_value_new_text(sq_text_new(strdup(argv[i])));
+		sq_book_push(args, sq_value_new_text(sq_text_new(strdup(argv[i]))));
 
-	return sq_value_new_book(sq_book_new2(argc, args));
+	return sq_value_new_book(args);
 }
 
 void sq_program_run(struct sq_program *program, unsigned argc, const char **argv) {
@@ -53,6 +53,15 @@ void *sq_realloc(void *ptr, size_t size) {
 	return ptr;
 }
 
+void *sq_malloc_aligned(size_t alignment, size_t size) {
+	void *ptr = aligned_alloc(alignment, size);
+
+	if (ptr == NULL && size)
+		memory_error("unable to allocate %zu bytes of memory aligned to %zu", size, alignment);
+
+	return ptr;
+}
+
 void *sq_memdup(void *ptr, size_t size) {
 	ptr = memcpy(sq_malloc_heap(size), ptr, size);
 
@@ -5,6 +5,7 @@
 #include <squire/exception.h>
 #include <squire/text.h>
 #include <squire/journey.h>
+#include <squire/form.h>
 
 struct sq_book *sq_book_new(size_t length, size_t capacity, sq_value *pages) {
 	sq_assert_le(length, capacity);
@@ -12,9 +13,14 @@ struct sq_book *sq_book_new(size_t length, size_t capacity, sq_value *pages) {
 
 	struct sq_book *book = sq_mallocv(struct sq_book);
 
+	book->has_front = false;
 	book->capacity = capacity;
 	book->length = length;
 	book->pages = pages;
+	book->sq_book_is_numerals = 1;
+
+	for (size_t i = 0; i < length && book->sq_book_is_numerals; ++i)
+		book->sq_book_is_numerals = sq_value_is_numeral(pages[i]);
 
 	return book;
 }
@@ -35,12 +41,36 @@ void sq_book_dump(FILE *out, const struct sq_book *book) {
 void sq_book_mark(struct sq_book *book) {
 	SQ_GUARD_MARK(book);
 
+	if (book->sq_book_is_numerals)
+		return;
+
 	for (size_t i = 0; i < book->length; ++i)
 		sq_value_mark(book->pages[i]);
 }
 
+void sq_book_relocate(struct sq_book *book) {
+	if (book->sq_book_is_numerals)
+		return;
+
+	for (size_t i = 0; i < book->length; ++i)
+		sq_gc_relocate(&book->pages[i]);
+}
+
+// The start of the allocation that `book->pages` is in.
+static sq_value *pages_start(const struct sq_book *book) {
+	return book->pages - sq_book_front(book);
+}
+
+// Records that there are `front` unused pages before `book->pages`.
+static void set_front(struct sq_book *book, size_t front) {
+	book->has_front = front != 0;
+
+	if (front)
+		book->pages[-1] = (sq_value) front;
+}
+
 void sq_book_deallocate(struct sq_book *book) {
-	free(book->pages);
+	sq_arena_free(pages_start(book), sq_sizeof_array(sq_value, sq_book_front(book) + book->capacity));
 	// free(book);
 }
 
@@ -58,44 +88,158 @@ size_t sq_book_fix_index(const struct sq_book *book, ssize_t index) {
 }
 
 
-static void expand_book(struct sq_book *book, size_t length) {
-	if (length < book->length)
+#define MINIMUM_CAPACITY 4
+
+// Moves `book`'s pages into a new allocation with `front` pages before them and `capacity` after.
+static void reallocate_book(struct sq_book *book, size_t front, size_t capacity) {
+	sq_assert_le(book->length, capacity);
+	size_t size = sq_sizeof_array(sq_value, sq_book_front(book) + book->capacity);
+	sq_value *start;
+
+	// When only growing the back, large allocations can often be extended where they are.
+	if (front == sq_book_front(book)) {
+		start = sq_arena_realloc(pages_start(book), size, sq_sizeof_array(sq_value, front + capacity),
+			sq_sizeof_array(sq_value, front + book->length));
+	} else {
+		start = sq_arena_malloc(sq_sizeof_array(sq_value, front + capacity));
+
+		if (book->length)
+			memcpy(start + front, book->pages, sq_sizeof_array(sq_value, book->length));
+		sq_arena_free(pages_start(book), size);
+	}
+
+	book->pages = start + front;
+	book->capacity = capacity;
+	set_front(book, front);
+}
+
+// Shifts `book`'s pages `amnt` pages towards the front (when negative) or the back.
+static void slide_pages(struct sq_book *book, ssize_t amnt) {
+	size_t front = sq_book_front(book);
+
+	memmove(book->pages + amnt, book->pages, sq_sizeof_array(sq_value, book->length));
+	book->pages += amnt;
+	book->capacity -= amnt;
+	set_front(book, front + amnt);
+}
+
+// Ensures that there's room for `length` pages, without moving `pages` backwards.
+static void reserve_back(struct sq_book *book, size_t length) {
+	if (length <= book->capacity)
 		return;
 
-	if (book->capacity <= length) {
-		// todo: increase capacity by two.
-		book->capacity = length * 2 + 1;
-		book->pages = sq_realloc_vec(sq_value, book->pages, book->capacity);
+	size_t front = sq_book_front(book);
+
+	// If more than half the allocation's unused and at the front, reuse it instead of growing.
+	if (book->length < front && length <= book->capacity + front / 2) {
+		slide_pages(book, -(ssize_t) ((front + 1) / 2));
+		return;
 	}
 
+	size_t capacity = book->length * 2;
+	if (capacity < length) capacity = length;
+	if (capacity < MINIMUM_CAPACITY) capacity = MINIMUM_CAPACITY;
+
+	reallocate_book(book, front, capacity);
+}
+
+// Ensures that there's room for at least one page before `pages`.
+static void reserve_front(struct sq_book *book) {
+	if (book->has_front)
+		return;
+
+	size_t unused = book->capacity - book->length;
+
+	// If more than half the allocation's unused and at the back, reuse it instead of growing.
+	if (book->length < unused) {
+		slide_pages(book, (unused + 1) / 2);
+		return;
+	}
+
+	reallocate_book(
+		book,
+		book->length < MINIMUM_CAPACITY ? MINIMUM_CAPACITY : book->length,
+		book->capacity
+	);
+}
+
+static void expand_book(struct sq_book *book, size_t length) {
+	if (length <= book->length)
+		return;
+
+	reserve_back(book, length);
+	book->sq_book_is_numerals = 0;
+
 	while (book->length < length)
 		book->pages[book->length++] = SQ_NI;
 }
 
 void sq_book_insert(struct sq_book *book, size_t index, sq_value value) {
-	expand_book(book, (book->length < index ? index : book->length) + 1);
+	if (book->length <= index) {
+		expand_book(book, index);
+		reserve_back(book, index + 1);
+		sq_book_push(book, value);
+		return;
+	}
 
-	memmove(
-		&book->pages[index + 1],
-		&book->pages[index],
-		sq_sizeof_array(sq_value, book->length - index)
-	);
+	// Move whichever side of `index` has the fewest pages.
+	if (index < book->length / 2) {
+		reserve_front(book);
+		size_t front = sq_book_front(book);
+
+		--book->pages;
+		++book->capacity;
+		set_front(book, front - 1);
+
+		memmove(
+			&book->pages[0],
+			&book->pages[1],
+			sq_sizeof_array(sq_value, index)
+		);
+	} else {
+		reserve_back(book, book->length + 1);
+
+		memmove(
+			&book->pages[index + 1],
+			&book->pages[index],
+			sq_sizeof_array(sq_value, book->length - index)
+		);
+	}
 
+	++book->length;
+	sq_gc_write_barrier(&book->basic, value);
+	book->sq_book_is_numerals &= sq_value_is_numeral(value);
+	book->sq_book_is_unchanged = 0;
 	book->pages[index] = value;
 }
 
 sq_value sq_book_delete(struct sq_book *book, size_t index) {
-
 	if (book->length <= index)
 		return SQ_NI;
 
 	sq_value result = book->pages[index];
-
-	memmove(
-		&book->pages[index],
-		&book->pages[index + 1],
-		sq_sizeof_array(sq_value, book->length - index)
-	);
+	book->sq_book_is_unchanged = 0;
+
+	// Move whichever side of `index` has the fewest pages.
+	if (index < book->length / 2) {
+		size_t front = sq_book_front(book);
+
+		memmove(
+			&book->pages[1],
+			&book->pages[0],
+			sq_sizeof_array(sq_value, index)
+		);
+
+		++book->pages;
+		--book->capacity;
+		set_front(book, front + 1);
+	} else {
+		memmove(
+			&book->pages[index],
+			&book->pages[index + 1],
+			sq_sizeof_array(sq_value, book->length - index - 1)
+		);
+	}
 
 	--book->length;
 
@@ -111,6 +255,9 @@ sq_value sq_book_index(const struct sq_book *book, size_t index) {
 
 void sq_book_index_assign(struct sq_book *book, size_t index, sq_value value) {
 	expand_book(book, index + 1);
+	sq_gc_write_barrier(&book->basic, value);
+	book->sq_book_is_numerals &= sq_value_is_numeral(value);
+	book->sq_book_is_unchanged = 0;
 	book->pages[index] = value;
 }
 
@@ -153,7 +300,7 @@ struct sq_book *sq_book_repeat(const struct sq_book *book, unsigned amnt) {
 
 	for (unsigned i = 0; i < amnt; ++i)
 		for (unsigned j = 0; j < book->length; ++j)
-			new->pages[new->length++] = book->pages[j];
+			sq_book_push(new, book->pages[j]);
 
 	return new;
 }
@@ -191,9 +338,9 @@ struct sq_book *sq_book_product(const struct sq_book *book, const struct sq_book
 	for (unsigned i = 0; i < book->length; ++i)
 		for (unsigned j = 0; j < rhs->length; ++j) {
 			struct sq_book *new = sq_book_allocate(2);
-			new->pages[new->length++] = book->pages[i];
-			new->pages[new->length++] = rhs->pages[i];
-			result->pages[result->length++] = sq_value_new_book(new);
+			sq_book_push(new, book->pages[i]);
+			sq_book_push(new, rhs->pages[i]);
+			sq_book_push(result, sq_value_new_book(new));
 		}
 
 	return result;
@@ -201,31 +348,266 @@ struct sq_book *sq_book_product(const struct sq_book *book, const struct sq_book
 
 struct sq_book *sq_book_map(const struct sq_book *book, const struct sq_journey *func) {
 	struct sq_book *result = sq_book_allocate(book->length);
+	struct sq_journey_call call;
+
+	sq_journey_call_prepare(&call, func, 1);
 
 	for (unsigned i = 0; i < book->length; ++i)
-		result->pages[result->length++] = sq_journey_run_deprecated(func, 1, &book->pages[i]);
+		sq_book_push(result, sq_journey_call_invoke(&call, &book->pages[i]));
 
+	sq_journey_call_finish(&call);
 	return result;
 }
 
 struct sq_book *sq_book_select(const struct sq_book *book, const struct sq_journey *func) {
 	struct sq_book *result = sq_book_allocate(book->length);
+	struct sq_journey_call call;
+
+	sq_journey_call_prepare(&call, func, 1);
 
 	for (unsigned i = 0; i < book->length; ++i)
-		if (sq_value_to_veracity(sq_journey_run_deprecated(func, 1, &book->pages[i])))
-			result->pages[result->length++] = book->pages[i];
+		if (sq_value_to_veracity(sq_journey_call_invoke(&call, &book->pages[i])))
+			sq_book_push(result, book->pages[i]);
 
+	sq_journey_call_finish(&call);
 	return result;
 }
 
 sq_value sq_book_reduce(const struct sq_book *book, const struct sq_journey *func) {
 	if (!book->length) return SQ_NI;
 	sq_value acc[2] = { book->pages[0] };
+	struct sq_journey_call call;
+
+	sq_journey_call_prepare(&call, func, 2);
 
 	for (unsigned i = 1; i < book->length; ++i) {
 		acc[1] = book->pages[i];
-		acc[0] = sq_journey_run_deprecated(func, 2, acc);
+		acc[0] = sq_journey_call_invoke(&call, acc);
 	}
 
+	sq_journey_call_finish(&call);
 	return acc[0];
 }
+
+// Runs shorter than this are sorted with a binary insertion sort before being merged.
+#define SORT_RUN_LENGTH 32
+
+struct sorter {
+	enum {
+		SORT_NUMERALS,  // every page is a numeral, and there's no comparator
+		SORT_TEXTS,     // every page is a text, and there's no comparator
+		SORT_NATURAL,   // no comparator; `sq_value_cmp` each pair of pages
+		SORT_PREPARED,  // a journey (either the comparator, or a shared `<=>`) via `call`
+		SORT_CALL       // any other comparator, called via `sq_value_call`.
+	} kind;
+	sq_value comparator;
+	struct sq_journey_call call;
+};
+
+static sq_numeral sort_compare(struct sorter *sorter, sq_value lhs, sq_value rhs) {
+	switch (sorter->kind) {
+	case SORT_NUMERALS: {
+		sq_numeral l = sq_value_as_numeral(lhs), r = sq_value_as_numeral(rhs);
+		return (l > r) - (l < r);
+	}
+
+	case SORT_TEXTS: {
+		const struct sq_text *l = sq_value_as_text(lhs), *r = sq_value_as_text(rhs);
+		int cmp = memcmp(l->ptr, r->ptr, l->length < r->length ? l->length : r->length);
+		return cmp ? cmp : (l->length > r->length) - (l->length < r->length);
+	}
+
+	case SORT_NATURAL:
+		return sq_value_cmp(lhs, rhs);
+
+	case SORT_PREPARED: {
+		sq_value args[2] = { lhs, rhs };
+		return sq_value_to_numeral(sq_journey_call_invoke(&sorter->call, args));
+	}
+
+	case SORT_CALL: {
+		sq_value args[2] = { lhs, rhs };
+		return sq_value_to_numeral(sq_value_call(sorter->comparator, (struct sq_args) { .pargc = 2, .pargv = args }));
+	}
+
+	default:
+		sq_bug("unknown sort kind %d", sorter->kind);
+	}
+}
+
+// Only `rhs < lhs` is ever asked, which is what keeps the sort stable.
+static inline bool sort_less(struct sorter *sorter, sq_value lhs, sq_value rhs) {
+	return sort_compare(sorter, lhs, rhs) < 0;
+}
+
+static void insertion_sort(struct sorter *sorter, sq_value *pages, size_t length) {
+	for (size_t i = 1; i < length; ++i) {
+		sq_value page = pages[i];
+		size_t low = 0, high = i;
+
+		// find the first page that's strictly greater than `page`, so equal pages keep their order.
+		while (low < high) {
+			size_t mid = low + (high - low) / 2;
+
+			if (sort_less(sorter, page, pages[mid]))
+				high = mid;
+			else
+				low = mid + 1;
+		}
+
+		memmove(pages + low + 1, pages + low, sq_sizeof_array(sq_value, i - low));
+		pages[low] = page;
+	}
+}
+
+static void merge_runs(
+	struct sorter *sorter,
+	const sq_value *from,
+	sq_value *into,
+	size_t start,
+	size_t middle,
+	size_t end
+) {
+	size_t left = start, right = middle, out = start;
+
+	// If the runs are already in order, there's nothing to merge.
+	if (!sort_less(sorter, from[middle], from[middle - 1])) {
+		memcpy(into + start, from + start, sq_sizeof_array(sq_value, end - start));
+		return;
+	}
+
+	while (left < middle && right < end) {
+		if (sort_less(sorter, from[right], from[left]))
+			into[out++] = from[right++];
+		else
+			into[out++] = from[left++];
+	}
+
+	memcpy(into + out, from + left, sq_sizeof_array(sq_value, middle - left));
+	out += middle - left;
+	memcpy(into + out, from + right, sq_sizeof_array(sq_value, end - right));
+}
+
+// A bottom-up merge sort; `pages` and `scratch` are swapped each pass, and the book whose pages
+// are sorted is returned.
+static struct sq_book *merge_sort(struct sorter *sorter, struct sq_book *pages, struct sq_book *scratch) {
+	size_t length = pages->length;
+
+	for (size_t start = 0; start < length; start += SORT_RUN_LENGTH)
+		insertion_sort(sorter, pages->pages + start, length - start < SORT_RUN_LENGTH ? length - start : SORT_RUN_LENGTH);
+
+	for (size_t width = SORT_RUN_LENGTH; width < length; width *= 2) {
+		for (size_t start = 0; start < length; start += 2 * width) {
+			size_t middle = start + width, end = middle + width;
+
+			if (length <= middle) {
+				memcpy(scratch->pages + start, pages->pages + start, sq_sizeof_array(sq_value, length - start));
+				continue;
+			}
+
+			merge_runs(sorter, pages->pages, scratch->pages, start, middle, length < end ? length : end);
+		}
+
+		struct sq_book *tmp = pages;
+		pages = scratch;
+		scratch = tmp;
+	}
+
+	return pages;
+}
+
+static bool every_page_is(const struct sq_book *book, enum sq_genus_tag genus) {
+	for (size_t i = 0; i < book->length; ++i)
+		if (sq_value_genus_tag(book->pages[i]) != genus)
+			return false;
+
+	return true;
+}
+
+// If every page is an imitation that shares the same `<=>` change, returns it.
+static struct sq_journey *shared_spaceship(const struct sq_book *book) {
+	if (!every_page_is(book, SQ_G_IMITATION))
+		return NULL;
+
+	struct sq_journey *cmp = sq_imitation_lookup_change(sq_value_as_imitation(book->pages[0]), "<=>");
+
+	for (size_t i = 1; cmp != NULL && i < book->length; ++i)
+		if (sq_imitation_lookup_change(sq_value_as_imitation(book->pages[i]), "<=>") != cmp)
+			return NULL;
+
+	return cmp;
+}
+
+// A copy of `book`'s pages, which the gc can see as long as it's referenced from the C stack.
+static struct sq_book *copy_pages(const struct sq_book *book) {
+	sq_value *pages = sq_arena_malloc(sq_sizeof_array(sq_value, book->length));
+	memcpy(pages, book->pages, sq_sizeof_array(sq_value, book->length));
+
+	return sq_book_new2(book->length, pages);
+}
+
+// Picks how `sorter` compares `book`'s pages, and prepares the journey call if it's needed.
+static void prepare_sorter(struct sorter *sorter, struct sq_book *book) {
+	struct sq_journey *journey = NULL;
+
+	if (sorter->comparator != SQ_NI)
+		sorter->kind = sq_value_is_journey(sorter->comparator) ? SORT_PREPARED : SORT_CALL;
+	else if (book->sq_book_is_numerals || (book->sq_book_is_numerals = every_page_is(book, SQ_G_NUMERAL)))
+		sorter->kind = SORT_NUMERALS;
+	else if (every_page_is(book, SQ_G_TEXT))
+		sorter->kind = SORT_TEXTS;
+	else
+		sorter->kind = SORT_NATURAL;
+
+	if (sorter->kind == SORT_PREPARED)
+		journey = sq_value_as_journey(sorter->comparator);
+	else if (sorter->kind == SORT_NATURAL && (journey = shared_spaceship(book)) != NULL)
+		sorter->kind = SORT_PREPARED;
+
+	if (journey != NULL)
+		sq_journey_call_prepare(&sorter->call, journey, 2);
+}
+
+void sq_book_sort(struct sq_book *book, sq_value comparator) {
+	size_t length = book->length;
+	struct sorter sorter = { .comparator = comparator };
+
+	if (length <= 1)
+		return;
+
+	// The pages are sorted in copies, so `book` keeps referencing every page while the
+	// comparator runs (and can't observe a half-merged book). Both copies start out with every
+	// page, and are only ever rearranged, so the gc can always mark through either of them.
+	struct sq_book *pages = copy_pages(book), *scratch = copy_pages(book);
+
+	// `sorter` isn't changed after the exception handler is installed, so it's still valid in it.
+	prepare_sorter(&sorter, book);
+
+	// If `book` is already being arranged (by a comparator of an outer sort), that sort has to
+	// find out that it was changed by this one.
+	bool outer_unchanged = book->sq_book_is_unchanged;
+	book->sq_book_is_unchanged = 1;
+
+	if (setjmp(exception_handlers[current_exception_handler++])) {
+		book->sq_book_is_unchanged &= outer_unchanged;
+
+		if (sorter.kind == SORT_PREPARED)
+			sq_journey_call_finish(&sorter.call);
+
+		sq_throw_value(sq_current_exception);
+	}
+
+	struct sq_book *sorted = merge_sort(&sorter, pages, scratch);
+	sq_exception_pop();
+
+	if (sorter.kind == SORT_PREPARED)
+		sq_journey_call_finish(&sorter.call);
+
+	bool unchanged = book->sq_book_is_unchanged;
+	book->sq_book_is_unchanged = 0;
+
+	if (!unchanged)
+		sq_throw("book was modified while being arranged");
+
+	memcpy(book->pages, sorted->pages, sq_sizeof_array(sq_value, length));
+}
@@ -1,16 +1,68 @@
 #include <squire/codex.h>
+#include <squire/arena.h>
 #include <squire/shared.h>
 #include <squire/text.h>
 
 #include <string.h>
 
+#define MINIMUM_CAPACITY 4
+
+static unsigned round_capacity(unsigned capacity) {
+	unsigned rounded = MINIMUM_CAPACITY;
+
+	// there's always at least one free page, so `sq_codex_index_assign` never overflows.
+	while (rounded <= capacity)
+		rounded *= 2;
+
+	return rounded;
+}
+
+static inline unsigned bucket_mask(const struct sq_codex *codex) {
+	return codex->capacity * 2 - 1;
+}
+
+static void insert_bucket(struct sq_codex *codex, unsigned page_index) {
+	unsigned mask = bucket_mask(codex);
+	unsigned bucket = codex->pages[page_index].hash & mask;
+
+	while (codex->buckets[bucket])
+		bucket = (bucket + 1) & mask;
+
+	codex->buckets[bucket] = page_index + 1;
+}
+
+static inline size_t pages_size(unsigned capacity) {
+	return sq_sizeof_array(struct sq_codex_page, capacity);
+}
+
+static inline size_t buckets_size(unsigned capacity) {
+	return sq_sizeof_array(unsigned, capacity * 2);
+}
+
+static unsigned *allocate_buckets(unsigned capacity) {
+	return memset(sq_arena_malloc(buckets_size(capacity)), 0, buckets_size(capacity));
+}
+
+// Builds the buckets from scratch; the old ones must've already been freed.
+static void reindex(struct sq_codex *codex) {
+	codex->buckets = allocate_buckets(codex->capacity);
+
+	for (unsigned i = 0; i < codex->length; ++i)
+		insert_bucket(codex, i);
+}
+
 struct sq_codex *sq_codex_new(unsigned length, unsigned capacity, struct sq_codex_page *pages) {
+	for (unsigned i = 0; i < length; ++i)
+		pages[i].hash = sq_value_hash(pages[i].key);
+
 	struct sq_codex *codex = sq_mallocv(struct sq_codex);
 
 	codex->length = length;
-	codex->capacity = capacity;
+	codex->capacity = round_capacity(capacity);
+	codex->pages = sq_arena_realloc(pages, pages_size(capacity), pages_size(codex->capacity),
+		pages_size(length));
 
-	codex->pages = pages;
+	reindex(codex);
 	return codex;
 }
 
@@ -18,9 +70,10 @@ struct sq_codex *sq_codex_allocate(unsigned capacity) {
 	struct sq_codex *codex = sq_mallocv(struct sq_codex);
 
 	codex->length = 0;
-	codex->capacity = capacity;
+	codex->capacity = round_capacity(capacity);
 
-	codex->pages = sq_malloc_vec(struct sq_codex_page, capacity);
+	codex->pages = sq_arena_malloc(pages_size(codex->capacity));
+	codex->buckets = allocate_buckets(codex->capacity);
 	return codex;
 }
 
@@ -47,8 +100,17 @@ void sq_codex_mark(struct sq_codex *codex) {
 	}
 }
 
+// Keys which are hashed by their address are pinned by the gc, so no page needs rehashing.
+void sq_codex_relocate(struct sq_codex *codex) {
+	for (unsigned i = 0; i < codex->length; ++i) {
+		sq_gc_relocate(&codex->pages[i].key);
+		sq_gc_relocate(&codex->pages[i].value);
+	}
+}
+
 void sq_codex_deallocate(struct sq_codex *codex) {
-	free(codex->pages);
+	sq_arena_free(codex->pages, pages_size(codex->capacity));
+	sq_arena_free(codex->buckets, buckets_size(codex->capacity));
 	// free(codex);
 }
 
@@ -91,28 +153,68 @@ struct sq_text *sq_codex_to_text(const struct sq_codex *codex) {
 	return sq_text_new2(str, len);
 }
 
+// Returns the bucket that refers to `key`, or the empty bucket where it'd go.
+static unsigned *find_bucket(struct sq_codex *codex, sq_value key, sq_hash hash) {
+	unsigned mask = bucket_mask(codex);
+	unsigned bucket = hash & mask;
+
+	for (; codex->buckets[bucket]; bucket = (bucket + 1) & mask) {
+		struct sq_codex_page *page = &codex->pages[codex->buckets[bucket] - 1];
+
+		if (page->hash == hash && sq_value_eql(page->key, key))
+			break;
+	}
+
+	return &codex->buckets[bucket];
+}
+
 struct sq_codex_page *sq_codex_fetch_page(struct sq_codex *codex, sq_value key) {
-	for (unsigned i = 0; i < codex->length; ++i)
-		if (sq_value_eql(codex->pages[i].key, key))
-			return &codex->pages[i];
+	unsigned bucket = *find_bucket(codex, key, sq_value_hash(key));
 
-	return NULL;
+	return bucket ? &codex->pages[bucket - 1] : NULL;
 }
 
-sq_value sq_codex_delete(struct sq_codex *codex, sq_value key) {
-	struct sq_codex_page *page = sq_codex_fetch_page(codex, key);
-	sq_value result = SQ_NI;
+// Empties `bucket`, shifting back any later buckets in its probe chain.
+static void remove_bucket(struct sq_codex *codex, unsigned bucket) {
+	unsigned mask = bucket_mask(codex);
+	unsigned next = bucket;
 
-	if (page) {
-		result = page->value;
+	while (codex->buckets[next = (next + 1) & mask]) {
+		unsigned home = codex->pages[codex->buckets[next] - 1].hash & mask;
 
-		if (codex->length != 1) {
-			page->key = codex->pages[--codex->length].key;
-			page->value = codex->pages[codex->length].value;
-		}
-		return page->value;
+		// only move `next` back if its home isn't (cyclically) within `(bucket, next]`.
+		if (((next - home) & mask) < ((next - bucket) & mask))
+			continue;
+
+		codex->buckets[bucket] = codex->buckets[next];
+		bucket = next;
 	}
 
+	codex->buckets[bucket] = 0;
+}
+
+sq_value sq_codex_delete(struct sq_codex *codex, sq_value key) {
+	unsigned *bucket = find_bucket(codex, key, sq_value_hash(key));
+
+	if (!*bucket)
+		return SQ_NI;
+
+	unsigned index = *bucket - 1;
+	sq_value result = codex->pages[index].value;
+
+	remove_bucket(codex, bucket - codex->buckets);
+
+	// Later pages are shifted down to keep insertion order, so buckets referring to them are too.
+	memmove(
+		&codex->pages[index],
+		&codex->pages[index + 1],
+		sq_sizeof_array(struct sq_codex_page, --codex->length - index)
+	);
+
+	for (unsigned i = 0; i < codex->capacity * 2; ++i)
+		if (index + 1 < codex->buckets[i])
+			--codex->buckets[i];
+
 	return result;
 }
 
@@ -126,20 +228,28 @@ sq_value sq_codex_index(struct sq_codex *codex, sq_value key) {
 }
 
 void sq_codex_index_assign(struct sq_codex *codex, sq_value key, sq_value value) {
-	struct sq_codex_page *page = sq_codex_fetch_page(codex, key);
+	sq_hash hash = sq_value_hash(key);
+	unsigned *bucket = find_bucket(codex, key, hash);
 
-	if (!page) {
-		// `+1` in case it starts out with 0 length
-		if (codex->capacity == codex->length) {
-			codex->pages = sq_realloc_vec(
-				struct sq_codex_page,
-				codex->pages,
-				codex->capacity = codex->capacity * 2 + 1
-			);
-		}
-		page = &codex->pages[codex->length++];
-		page->key = key;
+	sq_gc_write_barrier(&codex->basic, key);
+	sq_gc_write_barrier(&codex->basic, value);
+
+	if (*bucket) {
+		codex->pages[*bucket - 1].value = value;
+		return;
 	}
 
+	struct sq_codex_page *page = &codex->pages[codex->length];
+	page->key = key;
 	page->value = value;
+	page->hash = hash;
+	*bucket = ++codex->length;
+
+	if (codex->capacity == codex->length) {
+		sq_arena_free(codex->buckets, buckets_size(codex->capacity));
+		codex->pages = sq_arena_realloc(codex->pages, pages_size(codex->capacity),
+			pages_size(codex->capacity * 2), pages_size(codex->length));
+		codex->capacity *= 2;
+		reindex(codex);
+	}
 }
@@ -1,6 +1,7 @@
 #include <squire/form.h>
 #include <squire/shared.h>
 #include <squire/value.h>
+#include <squire/arena.h>
 
 #include <string.h>
 #include <assert.h>
@@ -19,6 +20,10 @@ struct sq_form *sq_form_new(char *name) {
 void sq_form_mark(struct sq_form *form) {
 	SQ_GUARD_MARK(form);
 
+	// it's possible for the gc to find a form before it's been initialized.
+	if (form->vt == NULL)
+		return;
+
 	for (unsigned i = 0; i < form->vt->nessences; ++i) {
 		sq_value_mark(form->vt->essences[i].value);
 
@@ -26,11 +31,15 @@ void sq_form_mark(struct sq_form *form) {
 			sq_value_mark(form->vt->essences[i].genus);
 	}
 
+	for (unsigned i = 0; i < form->vt->nmatter; ++i)
+		if (form->vt->matter[i].genus != SQ_UNDEFINED)
+			sq_value_mark(form->vt->matter[i].genus);
+
 	for (unsigned i = 0; i < form->vt->nrecollections; ++i) 
 		sq_journey_mark(form->vt->recollections[i]);
 
 	for (unsigned i = 0; i < form->vt->nchanges; ++i)
-		sq_journey_mark(form->vt->recollections[i]);
+		sq_journey_mark(form->vt->changes[i]);
 
 	if (form->vt->imitate != NULL)
 		sq_journey_mark(form->vt->imitate);
@@ -39,7 +48,38 @@ void sq_form_mark(struct sq_form *form) {
 		sq_form_mark(form->vt->parents[i]);
 }
 
+void sq_form_relocate(struct sq_form *form) {
+	if (form->vt == NULL)
+		return;
+
+	for (unsigned i = 0; i < form->vt->nessences; ++i) {
+		sq_gc_relocate(&form->vt->essences[i].value);
+
+		if (form->vt->essences[i].genus != SQ_UNDEFINED)
+			sq_gc_relocate(&form->vt->essences[i].genus);
+	}
+
+	for (unsigned i = 0; i < form->vt->nmatter; ++i)
+		if (form->vt->matter[i].genus != SQ_UNDEFINED)
+			sq_gc_relocate(&form->vt->matter[i].genus);
+
+	for (unsigned i = 0; i < form->vt->nrecollections; ++i)
+		form->vt->recollections[i] = sq_gc_relocated(form->vt->recollections[i]);
+
+	for (unsigned i = 0; i < form->vt->nchanges; ++i)
+		form->vt->changes[i] = sq_gc_relocated(form->vt->changes[i]);
+
+	if (form->vt->imitate != NULL)
+		form->vt->imitate = sq_gc_relocated(form->vt->imitate);
+
+	for (unsigned i = 0; i < form->vt->nparents; ++i)
+		form->vt->parents[i] = sq_gc_relocated(form->vt->parents[i]);
+}
+
 void sq_form_deallocate(struct sq_form *form) {
+	if (form->vt == NULL)
+		return;
+
 	for (unsigned i = 0; i < form->vt->nessences; ++i)
 		free(form->vt->essences[i].name);
 
@@ -104,6 +144,7 @@ bool sq_form_set_attr(struct sq_form *form, const char *attr, sq_value value) {
 	if (essence->genus != SQ_UNDEFINED && !sq_value_matches(essence->genus, value))
 		sq_throw("essence didnt match!");
 
+	sq_gc_write_barrier(&form->basic, value);
 	essence->value = value;
 
 	return true;
@@ -152,6 +193,7 @@ struct sq_imitation *sq_form_imitate(struct sq_form *form, struct sq_args args)
 	struct sq_imitation *imitation = sq_mallocv(struct sq_imitation);
 
 	imitation->form = form;
+	imitation->nmatter = form->vt->nmatter;
 
 	if (!form->vt->imitate) {
 		if (args.pargc != form->vt->nmatter)
@@ -161,9 +203,12 @@ struct sq_imitation *sq_form_imitate(struct sq_form *form, struct sq_args args)
 			if (form->vt->matter[i].genus != SQ_UNDEFINED && !sq_value_matches(form->vt->matter[i].genus, args.pargv[i]))
 				sq_throw("type error in constructor");
 
-		imitation->matter = sq_memdup(args.pargv, sq_sizeof_array(sq_value, form->vt->nmatter));
+		imitation->matter = sq_arena_malloc(sq_sizeof_array(sq_value, imitation->nmatter));
+
+		if (imitation->nmatter)
+			memcpy(imitation->matter, args.pargv, sq_sizeof_array(sq_value, imitation->nmatter));
 	} else {
-		imitation->matter = sq_malloc_vec(sq_value, form->vt->nmatter);
+		imitation->matter = sq_arena_malloc(sq_sizeof_array(sq_value, imitation->nmatter));
 
 		for (unsigned i = 0; i < form->vt->nmatter; ++i)
 			imitation->matter[i]=  SQ_NI;
@@ -187,6 +232,7 @@ struct sq_imitation *sq_imitation_new(struct sq_form *form, sq_value *matter) {
 
 	imitation->form = form;
 	imitation->matter = matter;
+	imitation->nmatter = form->vt->nmatter;
 
 	return imitation;
 }
@@ -246,6 +292,7 @@ bool sq_imitation_set_attr(struct sq_imitation *imitation, const char *attr, sq_
 	if (imitation->form->vt->matter[index].genus != SQ_UNDEFINED && !sq_value_matches(imitation->form->vt->matter[index].genus, value))
 		sq_throw("matter didnt match!");
 
+	sq_gc_write_barrier(&imitation->basic, value);
 	imitation->matter[index] = value;
 
 	return true;
@@ -254,13 +301,27 @@ bool sq_imitation_set_attr(struct sq_imitation *imitation, const char *attr, sq_
 void sq_imitation_mark(struct sq_imitation *imitation) {
 	SQ_GUARD_MARK(imitation);
 
+	// it's possible for the gc to find an imitation before it's been initialized.
+	if (imitation->form == NULL)
+		return;
+
 	sq_form_mark(imitation->form);
-	for (unsigned i = 0; i < imitation->form->vt->nmatter; ++i)
+	for (unsigned i = 0; imitation->matter != NULL && i < imitation->form->vt->nmatter; ++i)
 		sq_value_mark(imitation->matter[i]);
 }
 
+void sq_imitation_relocate(struct sq_imitation *imitation) {
+	if (imitation->form == NULL)
+		return;
+
+	for (unsigned i = 0; imitation->matter != NULL && i < imitation->nmatter; ++i)
+		sq_gc_relocate(&imitation->matter[i]);
+
+	imitation->form = sq_gc_relocated(imitation->form);
+}
+
 void sq_imitation_deallocate(struct sq_imitation *imitation) {
-	free(imitation->matter);
+	sq_arena_free(imitation->matter, sq_sizeof_array(sq_value, imitation->nmatter));
 }
 
 void sq_imitation_dump(FILE *out, const struct sq_imitation *imitation) {
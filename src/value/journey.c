@@ -7,6 +7,8 @@
 #include <squire/form.h>
 #include <squire/book.h>
 #include <squire/codex.h>
+#include <squire/census.h>
+#include <squire/opcount.h>
 
 #include <assert.h>
 #include <stdlib.h>
@@ -44,6 +46,7 @@ static void deallocate_pattern(struct sq_journey_pattern *pattern) {
 	free(pattern->kwargv);
 	free(pattern->code.consts);
 	free(pattern->code.bytecode);
+	free(pattern->code.live);
 }
 
 void sq_stackframe_mark(struct sq_stackframe *stackframe) {
@@ -56,8 +59,30 @@ found:
 #endif
 	
 	sq_journey_mark((struct sq_journey *)  stackframe->journey); // lol we just removed constness..
-	for (unsigned i = 0; i < stackframe->pattern->code.nlocals;	++i)
-		sq_value_mark(stackframe->locals[i]);
+
+	const struct sq_codeblock *code = &stackframe->pattern->code;
+
+	for (unsigned i = 0; i < code->nlocals; ++i) {
+		// Dead temporaries are cleared, so they're not kept alive by anything else either.
+		if (code->live != NULL
+			&& (stackframe->ip < code->live[i].start || code->live[i].end < stackframe->ip))
+			stackframe->locals[i] = SQ_NI;
+		else
+			sq_value_mark(stackframe->locals[i]);
+	}
+}
+
+void sq_stackframe_relocate(struct sq_stackframe *stackframe) {
+	for (unsigned i = 0; i < stackframe->pattern->code.nlocals; ++i)
+		sq_gc_relocate(&stackframe->locals[i]);
+
+	stackframe->journey = sq_gc_relocated((void *) stackframe->journey);
+}
+
+void sq_journey_relocate(struct sq_journey *journey) {
+	for (unsigned i = 0; i < journey->npatterns; ++i)
+		for (unsigned j = 0; j < journey->patterns[i].code.nconsts; ++j)
+			sq_gc_relocate(&journey->patterns[i].code.consts[j]);
 }
 
 void sq_journey_mark(struct sq_journey *journey) {
@@ -106,7 +131,7 @@ static int assign_positional_arguments(
 		splat = sq_book_allocate(args->pargc - i);
 
 		for (unsigned j = i; j < args->pargc; ++j)
-			splat->pages[splat->length++] = args->pargv[j];
+			sq_book_push(splat, args->pargv[j]);
 	} else {
 		// we have fewer arguments than total argument count, so either fill out defaults, or return -1.
 
@@ -129,11 +154,9 @@ static int assign_positional_arguments(
 		if (pattern->pargv[j].genus_start < 0)
 			continue;
 
+		// A genus's code returns whether the argument matches it.
 		sf->ip = pattern->pargv[j].genus_start;
-		sq_value genus = sq_run_stackframe(sf);
-
-		bool matches = sq_value_matches(genus, sf->locals[j]);
-		if (!matches)
+		if (!sq_value_to_veracity(sq_run_stackframe(sf)))
 			return -1;
 	}
 
@@ -155,16 +178,20 @@ unsigned sq_current_stackframe;
 static sq_value try_run_pattern(
 	const struct sq_journey *journey,
 	const struct sq_journey_pattern *pattern,
-	struct sq_args *args
+	struct sq_args *args,
+	sq_value *locals
 ) {
 	if (sq_current_stackframe == SQ_MAX_STACKFRAME_COUNT)
 		sq_throw("too many stackframes encountered");
 
+	SQ_STATIC_ASSERT(SQ_NI == 0, "locals are zeroed to make them all `ni`");
+	memset(locals, 0, sq_sizeof_array(sq_value, pattern->code.nlocals));
+
 	struct sq_stackframe *sf = &sq_stackframes[sq_current_stackframe++];
 	*sf = (struct sq_stackframe) {
 		.journey = journey,
 		.pattern = pattern,
-		.locals = calloc(sizeof(sq_value), pattern->code.nlocals)
+		.locals = locals
 	};
 
 	sq_value result = SQ_UNDEFINED;
@@ -172,7 +199,7 @@ static sq_value try_run_pattern(
 	int positional_argument_stop_index = assign_positional_arguments(sf, pattern, args);
 
 	if (positional_argument_stop_index < 0)
-		goto free_and_return;
+		goto pop_and_return;
 
 	// todo: handle keyword arguments
 
@@ -181,27 +208,131 @@ static sq_value try_run_pattern(
 		sf->ip = pattern->condition_start;
 		sq_value condition = sq_run_stackframe(sf);
 		bool is_valid = sq_value_to_numeral(condition);
-		if (!is_valid) goto free_and_return;
+		if (!is_valid) goto pop_and_return;
 	}
 
 	sf->ip = pattern->start_index;
 	result = sq_run_stackframe(sf);
 
-free_and_return:
-	free(sf->locals);
+pop_and_return:
 	--sq_current_stackframe;
 	return result;
 }
 
-sq_value sq_journey_run(const struct sq_journey *journey, struct sq_args args) {
+// Whether `pattern` could ever accept `pargc` positional arguments.
+static bool can_accept_argc(const struct sq_journey_pattern *pattern, unsigned pargc) {
+	if (pattern->pargc < pargc)
+		return pattern->splat;
+
+	if (pargc < pattern->pargc)
+		return 0 <= pattern->pargv[pargc].default_start;
+
+	return true;
+}
+
+// Whether `pattern` accepts every call with `pargc` positional arguments.
+static bool always_accepts_argc(const struct sq_journey_pattern *pattern, unsigned pargc) {
+	if (pattern->pargc != pargc || 0 <= pattern->condition_start)
+		return false;
+
+	for (unsigned i = 0; i < pattern->pargc; ++i)
+		if (0 <= pattern->pargv[i].genus_start)
+			return false;
+
+	return true;
+}
+
+void sq_journey_call_prepare(struct sq_journey_call *call, const struct sq_journey *journey, unsigned pargc) {
+	unsigned nlocals = 0;
+
+	call->journey = journey;
+	call->pattern = NULL;
+	call->pargc = pargc;
+	call->first_pattern = journey->npatterns;
+	call->active = 0;
+
+	for (unsigned i = 0; i < journey->npatterns; ++i) {
+		const struct sq_journey_pattern *pattern = &journey->patterns[i];
+
+		if (nlocals < pattern->code.nlocals)
+			nlocals = pattern->code.nlocals;
+
+		if (call->first_pattern != journey->npatterns || !can_accept_argc(pattern, pargc))
+			continue;
+
+		call->first_pattern = i;
+		if (always_accepts_argc(pattern, pargc))
+			call->pattern = pattern;
+	}
+
+	call->nlocals = nlocals;
+
+	if (nlocals <= SQ_JOURNEY_CALL_INLINE_LOCALS)
+		call->locals = call->inline_locals;
+	else
+		call->locals = sq_malloc_vec(sq_value, nlocals);
+}
+
+// Returns `SQ_UNDEFINED` if no pattern matched.
+static sq_value invoke_patterns(const struct sq_journey_call *call, struct sq_args *args, sq_value *locals) {
 	sq_value result;
 
-	for (unsigned i = 0; i < journey->npatterns; ++i)
-		if ((result = try_run_pattern(journey, &journey->patterns[i], &args)) != SQ_UNDEFINED)
+	if (call->pattern != NULL) {
+		result = try_run_pattern(call->journey, call->pattern, args, locals);
+		sq_assert_ne(result, SQ_UNDEFINED);
+		return result;
+	}
+
+	for (unsigned i = call->first_pattern; i < call->journey->npatterns; ++i) {
+		result = try_run_pattern(call->journey, &call->journey->patterns[i], args, locals);
+
+		if (result != SQ_UNDEFINED)
 			return result;
+	}
+
+	return SQ_UNDEFINED;
+}
+
+sq_value sq_journey_call_invoke(struct sq_journey_call *call, sq_value *pargv) {
+	struct sq_args args = { .pargc = call->pargc, .pargv = pargv };
+	sq_value reentrant_locals[SQ_JOURNEY_CALL_INLINE_LOCALS];
+	sq_value *locals = call->locals;
+
+	// The call's already running further up the stack, so its locals are taken.
+	if (call->active++) {
+		if (call->nlocals <= SQ_JOURNEY_CALL_INLINE_LOCALS)
+			locals = reentrant_locals;
+		else
+			locals = sq_malloc_vec(sq_value, call->nlocals);
+	}
+
+	sq_value result = invoke_patterns(call, &args, locals);
+
+	--call->active;
+
+	if (locals != call->locals && locals != reentrant_locals)
+		free(locals);
 
 	// whelp, no pattern matched. exception time!
-	sq_throw("no patterns match for '%s'", journey->name);
+	if (result == SQ_UNDEFINED)
+		sq_throw("no patterns match for '%s'", call->journey->name);
+
+	return result;
+}
+
+void sq_journey_call_finish(struct sq_journey_call *call) {
+	if (call->locals != call->inline_locals)
+		free(call->locals);
+}
+
+sq_value sq_journey_run(const struct sq_journey *journey, struct sq_args args) {
+	struct sq_journey_call call;
+
+	sq_journey_call_prepare(&call, journey, args.pargc);
+	sq_value result = sq_journey_call_invoke(&call, args.pargv);
+	sq_journey_call_finish(&call);
+
+	return result;
 }
 
 // static void setup_stackframe(struct sq_stackframe *stackframe, struct sq_args args) {
@@ -383,6 +514,14 @@ static struct sq_text *do_babel(
 	return sq_text_new(result);
 }
 
+static sq_value sort_book(sq_value book, sq_value comparator) {
+	if (!sq_value_is_book(book))
+		sq_throw("can only arrange books, not '%s'", sq_value_typename(book));
+
+	sq_book_sort(sq_value_as_book(book), comparator);
+	return book;
+}
+
 static void handle_interrupt(struct sq_stackframe *sf) {
 #ifdef SQ_USE_COMPUTED_GOTOS
 	static const void *labels[] = {
@@ -408,6 +547,8 @@ static void handle_interrupt(struct sq_stackframe *sf) {
 		[SQ_INT_ARRAY_INSERT] = &&VM_CASE_NAME(SQ_INT_ARRAY_INSERT),
 		[SQ_INT_ARRAY_DELETE] = &&VM_CASE_NAME(SQ_INT_ARRAY_DELETE),
 		[SQ_INT_BABEL] = &&VM_CASE_NAME(SQ_INT_BABEL),
+		[SQ_INT_SORT] = &&VM_CASE_NAME(SQ_INT_SORT),
+		[SQ_INT_SORT_BY] = &&VM_CASE_NAME(SQ_INT_SORT_BY),
 		[SQ_INT_ARABIC] = &&VM_CASE_NAME(SQ_INT_ARABIC),
 		[SQ_INT_ROMAN] = &&VM_CASE_NAME(SQ_INT_ROMAN),
 		[SQ_INT_FOPEN] = &&VM_CASE_NAME(SQ_INT_FOPEN),
@@ -419,6 +560,7 @@ static void handle_interrupt(struct sq_stackframe *sf) {
 #endif /* defined(SQ_USE_COMPUTED_GOTOS) */
 
 	enum sq_interrupt interrupt = next_bytecode(sf).interrupt;
+	sq_count_interrupt(interrupt);
 	sq_value operands[SQ_INTERRUPT_MAX_ARITY];
 	struct sq_text *text;
 	struct sq_other *other;
@@ -614,9 +756,9 @@ static void handle_interrupt(struct sq_stackframe *sf) {
 		unsigned amnt = next_count(sf);
 		struct sq_codex *codex = sq_codex_allocate(amnt);
 
-		for (; codex->length < amnt; ++codex->length) {
-			codex->pages[codex->length].key = *next_local(sf);
-			codex->pages[codex->length].value = *next_local(sf);
+		for (unsigned i = 0; i < amnt; ++i) {
+			sq_value key = *next_local(sf);
+			sq_codex_index_assign(codex, key, *next_local(sf));
 		}
 
 		set_next_local(sf, sq_value_new_codex(codex));
@@ -628,8 +770,8 @@ static void handle_interrupt(struct sq_stackframe *sf) {
 		unsigned amnt = next_count(sf);
 		struct sq_book *book = sq_book_allocate(amnt);
 
-		for (; book->length < amnt; ++book->length)
-			book->pages[book->length] = *next_local(sf);
+		while (book->length < amnt)
+			sq_book_push(book, *next_local(sf));
 
 		set_next_local(sf, sq_value_new_book(book));
 		return;
@@ -660,6 +802,16 @@ static void handle_interrupt(struct sq_stackframe *sf) {
 		return;
 	}
 
+	// [A,DST] DST <- A, after sorting A in place
+	VM_CASE(SQ_INT_SORT)
+		set_next_local(sf, sort_book(operands[0], SQ_NI));
+		return;
+
+	// [A,B,DST] DST <- A, after sorting A in place using B as the comparator
+	VM_CASE(SQ_INT_SORT_BY)
+		set_next_local(sf, sort_book(operands[0], operands[1]));
+		return;
+
 	// [A,...,B,DST] DST <- babel(exec=A,stdin=B,args=...)c
 	VM_CASE(SQ_INT_BABEL) {
 		unsigned amnt = next_count(sf);
@@ -780,6 +932,7 @@ static sq_value sq_run_stackframe(struct sq_stackframe *sf) {
 #endif /* !defined(NDEBUG) */
 
 		opcode = next_bytecode(sf).opcode;
+		sq_count_opcode(opcode);
 		arity = sq_opcode_arity(opcode);
 
 #ifdef __clang__
@@ -813,6 +966,14 @@ static sq_value sq_run_stackframe(struct sq_stackframe *sf) {
 	/*** Control Flow ***/
 		VM_CASE(SQ_OC_JMP)
 			sf->ip = next_index(sf);
+
+			// Only the outermost journey is running here, so no C code is holding values where the
+			// gc can't see them.
+			if (SQ_UNLIKELY(sq_gc_safepoint_pending) && sq_current_stackframe == 1)
+				sq_gc_safepoint();
+
+			if (SQ_UNLIKELY(sq_census_requested))
+				sq_census_take_requested();
 			continue;
 
 		VM_CASE(SQ_OC_JMP_FALSE)
@@ -871,10 +1032,13 @@ static sq_value sq_run_stackframe(struct sq_stackframe *sf) {
 			// todo: maybe have this be within the `stackframe`?
 			unsigned catch_index = next_index(sf);
 			unsigned exception_index = next_index(sf);
+			unsigned stackframe = sq_current_stackframe;
 
 			if (!setjmp(exception_handlers[current_exception_handler++]))
 				continue;
 
+			// discard the frames of every journey that was unwound by the exception.
+			sq_current_stackframe = stackframe;
 			sf->locals[exception_index] = sq_current_exception;
 			sq_current_exception = SQ_NI;
 			sf->ip = catch_index;
@@ -976,6 +1140,7 @@ static sq_value sq_run_stackframe(struct sq_stackframe *sf) {
 			sq_assert(sq_value_is_form(operands[0]));
 			sq_assert_lt(index, sq_value_as_form(operands[0])->vt->nessences);
 			sq_assert(sq_value_as_form(operands[0])->vt->essences[index].genus == SQ_UNDEFINED);
+			sq_gc_write_barrier(&sq_value_as_form(operands[0])->basic, operands[1]);
 			sq_value_as_form(operands[0])->vt->essences[index].genus = operands[1];
 			continue;
 
@@ -984,6 +1149,7 @@ static sq_value sq_run_stackframe(struct sq_stackframe *sf) {
 			sq_assert(sq_value_is_form(operands[0]));
 			sq_assert_lt(index, sq_value_as_form(operands[0])->vt->nmatter);
 			sq_assert(sq_value_as_form(operands[0])->vt->matter[index].genus == SQ_UNDEFINED);
+			sq_gc_write_barrier(&sq_value_as_form(operands[0])->basic, operands[1]);
 			sq_value_as_form(operands[0])->vt->matter[index].genus = operands[1];
 			continue;
 		VM_SWITCH_END
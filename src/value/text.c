@@ -12,6 +12,7 @@ static struct sq_text *allocate_text(unsigned length) {
 	struct sq_text *text = sq_mallocv(struct sq_text);
 
 	text->length = length;
+	text->hash = 0;
 
 	return text;
 }
@@ -41,8 +42,106 @@ struct sq_text *sq_text_allocate(unsigned length) {
 	return text;
 }
 
-void sq_text_deallocate(struct sq_text *text) {
+/*
+ * The contents of deduplicated texts, found by hash and then compared. Each is freed once
+ * every text sharing it has been.
+ */
+struct shared_contents {
+	char *ptr; // `NULL` for empty slots
+	unsigned length, refs;
+	sq_hash hash;
+};
+
+static struct {
+	struct shared_contents *slots;
+	size_t length, capacity; // `capacity` is always a power of two.
+} shared;
+
+static struct shared_contents *find_shared(sq_hash hash, const char *ptr, unsigned length) {
+	size_t mask = shared.capacity - 1;
+	struct shared_contents *slot;
+
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		slot = &shared.slots[i];
+
+		if (slot->ptr == NULL || (slot->hash == hash && slot->length == length
+			&& (slot->ptr == ptr || !memcmp(slot->ptr, ptr, length))))
+			return slot;
+	}
+}
+
+static void grow_shared(void) {
+	struct shared_contents *old = shared.slots;
+	size_t old_capacity = shared.capacity;
+
+	shared.capacity = old_capacity ? old_capacity * 2 : 1024;
+	shared.slots = sq_calloc(shared.capacity, sizeof *shared.slots);
+
+	for (size_t i = 0; i < old_capacity; ++i)
+		if (old[i].ptr != NULL)
+			*find_shared(old[i].hash, old[i].ptr, old[i].length) = old[i];
+
+	free(old);
+}
+
+// Empties `slot`, moving back any later ones that would no longer be found past it.
+static void remove_shared(struct shared_contents *slot) {
+	size_t mask = shared.capacity - 1, hole = slot - shared.slots;
+
+	for (size_t i = (hole + 1) & mask; shared.slots[i].ptr != NULL; i = (i + 1) & mask) {
+		size_t home = shared.slots[i].hash & mask;
+
+		if (((i - hole) & mask) <= ((i - home) & mask)) {
+			shared.slots[hole] = shared.slots[i];
+			hole = i;
+		}
+	}
+
+	shared.slots[hole].ptr = NULL;
+	--shared.length;
+}
+
+size_t sq_text_deduplicate(struct sq_text *text) {
+	if (text->sq_text_is_deduplicated)
+		return 0;
+
+	if (shared.capacity <= 2 * shared.length)
+		grow_shared();
+
+	sq_hash hash = sq_text_hash(text);
+	struct shared_contents *slot = find_shared(hash, text->ptr, text->length);
+	text->sq_text_is_deduplicated = 1;
+
+	if (slot->ptr == NULL) {
+		*slot = (struct shared_contents) { .ptr = text->ptr, .length = text->length, .refs = 1, .hash = hash };
+		++shared.length;
+		return 0;
+	}
+
 	free(text->ptr);
+	text->ptr = slot->ptr;
+	++slot->refs;
+	return text->length + 1;
+}
+
+void sq_text_deallocate(struct sq_text *text) {
+	if (!text->sq_text_is_deduplicated) {
+		free(text->ptr);
+		return;
+	}
+
+	struct shared_contents *slot = find_shared(sq_text_hash(text), text->ptr, text->length);
+	sq_assert_eq(slot->ptr, text->ptr);
+
+	if (--slot->refs == 0) {
+		free(slot->ptr);
+		remove_shared(slot);
+	}
+}
+
+// Texts are never modified after they're constructed, so their hash can be cached.
+sq_hash sq_text_hash_slow(struct sq_text *text) {
+	return text->hash = sq_hash_bytes(text->ptr, text->length);
 }
 
 
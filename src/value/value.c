@@ -88,6 +88,19 @@ void sq_value_mark(sq_value value) {
 	}
 }
 
+void sq_value_relocate(sq_value value) {
+	sq_assert_nundefined(value);
+
+	switch (SQ_VTAG(value)) {
+	case SQ_G_FORM: sq_form_relocate(AS_FORM(value)); break;
+	case SQ_G_IMITATION: sq_imitation_relocate(AS_IMITATION(value)); break;
+	case SQ_G_JOURNEY: sq_journey_relocate(AS_JOURNEY(value)); break;
+	case SQ_G_BOOK: sq_book_relocate(AS_BOOK(value)); break;
+	case SQ_G_CODEX: sq_codex_relocate(AS_CODEX(value)); break;
+	case SQ_G_OTHER: if (sq_value_is_other(value)) sq_other_relocate(AS_OTHER(value)); break;
+	}
+}
+
 void sq_value_deallocate(sq_value value) {
 	sq_assert_nundefined(value);
 
@@ -173,7 +186,14 @@ bool sq_value_not(sq_value arg) {
 bool sq_value_eql(sq_value lhs, sq_value rhs) {
 	switch (SQ_VTAG(lhs)) {
 	case SQ_G_TEXT:
-		return sq_value_is_text(rhs) && !strcmp(AS_STR(lhs), AS_STR(rhs));
+		if (!sq_value_is_text(rhs)) return false;
+		struct sq_text *ltext = AS_TEXT(lhs), *rtext = AS_TEXT(rhs);
+
+		return ltext == rtext || (
+			ltext->length == rtext->length
+				&& (!ltext->hash || !rtext->hash || ltext->hash == rtext->hash)
+				&& !memcmp(ltext->ptr, rtext->ptr, ltext->length)
+		);
 
 	case SQ_G_BOOK:
 		if (!sq_value_is_book(rhs)) return false;
@@ -182,6 +202,10 @@ bool sq_value_eql(sq_value lhs, sq_value rhs) {
 		if (lary->length != rary->length)
 			return false;
 
+		// numerals are equal only when they're identical, so there's no need to go page-by-page.
+		if (lary->sq_book_is_numerals && rary->sq_book_is_numerals)
+			return !memcmp(lary->pages, rary->pages, sq_sizeof_array(sq_value, lary->length));
+
 		for (unsigned i = 0; i < lary->length; ++i)
 			if (!sq_value_eql(lary->pages[i], rary->pages[i]))
 				return false;
@@ -218,6 +242,51 @@ bool sq_value_eql(sq_value lhs, sq_value rhs) {
 	}
 }
 
+sq_hash sq_value_hash(sq_value value) {
+	sq_hash hash;
+
+	switch (SQ_VTAG(value)) {
+	case SQ_G_TEXT:
+		return sq_text_hash(AS_TEXT(value));
+
+	case SQ_G_BOOK: {
+		struct sq_book *book = AS_BOOK(value);
+		hash = sq_hash_integer(book->length);
+
+		for (unsigned i = 0; i < book->length; ++i)
+			hash = sq_hash_combine(hash, sq_value_hash(book->pages[i]));
+
+		return hash;
+	}
+
+	case SQ_G_CODEX: {
+		// Codices are compared by their values only (see `sq_value_eql`), so keys aren't hashed.
+		struct sq_codex *codex = AS_CODEX(value);
+		hash = sq_hash_integer(codex->length);
+
+		for (unsigned i = 0; i < codex->length; ++i)
+			hash = sq_hash_combine(hash, sq_value_hash(codex->pages[i].value));
+
+		return hash;
+	}
+
+	case SQ_G_IMITATION: {
+		struct sq_journey *hash_change = sq_imitation_lookup_change(AS_IMITATION(value), "hash");
+
+		if (hash_change != NULL)
+			return sq_hash_integer(
+				sq_value_to_numeral(sq_journey_run_deprecated(hash_change, 1, &value))
+			);
+
+		SQ_FALLTHROUGH
+	}
+
+	default:
+		// Numerals are canonically encoded, and everything else is compared by identity.
+		return sq_hash_integer(value);
+	}
+}
+
 sq_numeral sq_value_cmp(sq_value lhs, sq_value rhs) {
 	switch (SQ_VTAG(lhs)) {
 	case SQ_G_NUMERAL: {
@@ -365,7 +434,7 @@ sq_value sq_value_add(sq_value lhs, sq_value rhs) {
 		struct sq_book *lary = AS_BOOK(lhs), *rary = sq_value_to_book(rhs);
 
 		unsigned length = lary->length + rary->length;
-		sq_value *pages = sq_malloc_vec(sq_value, length);
+		sq_value *pages = sq_arena_malloc(sq_sizeof_array(sq_value, length));
 
 		// todo: memcpy
 		for (unsigned i = 0; i < lary->length; ++i)
@@ -797,7 +866,7 @@ struct sq_book *sq_value_to_book(sq_value value) {
 			char *data = sq_malloc_heap(2);
 			data[0] = text->ptr[i];
 			data[1] = '\0';
-			book->pages[book->length++] = sq_value_new_text(sq_text_new2(data, 1));
+			sq_book_push(book, sq_value_new_text(sq_text_new2(data, 1)));
 		}
 
 		return book;
@@ -808,14 +877,14 @@ struct sq_book *sq_value_to_book(sq_value value) {
 		sq_numeral numeral = AS_NUMBER(value);
 		if (numeral == 0) {
 			struct sq_book *book = sq_book_allocate(1);
-			book->pages[book->length++] = value;
+			sq_book_push(book, value);
 			return book;
 		}
 
 		struct sq_book *book = sq_book_allocate(40); // eh, 40's enough memory right?
 
 		for (; numeral; numeral /= 10) {
-			book->pages[book->length++] = sq_value_new_numeral(numeral % 10);
+			sq_book_push(book, sq_value_new_numeral(numeral % 10));
 		}
 
 		sq_value tmp;
@@ -945,10 +1014,11 @@ bool sq_value_matches(sq_value formlike, sq_value to_check) {
 		return sq_form_is_parent_of(AS_FORM(formlike), to_check);
 
 	case SQ_G_JOURNEY: {
-		struct sq_args args = { .pargc = 1, .pargv = &to_check };
+		struct sq_journey_call call;
 
-		sq_value result = sq_journey_run(AS_JOURNEY(formlike), args);
-		matches = sq_value_to_veracity(result);
+		sq_journey_call_prepare(&call, AS_JOURNEY(formlike), 1);
+		matches = sq_value_to_veracity(sq_journey_call_invoke(&call, &to_check));
+		sq_journey_call_finish(&call);
 
 		return matches;
 	}